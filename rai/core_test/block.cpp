@@ -325,3 +325,98 @@ TEST (block, confirm_req_serialization)
 	ASSERT_EQ (req, req2);
 	ASSERT_EQ (*req.block, *req2.block);
 }
+
+TEST (block, view)
+{
+	rai::keypair key1;
+	rai::send_block send1 (1, key1.pub, 2, key1.prv, key1.pub, 3);
+	rai::open_block open1 (4, key1.pub, key1.pub, key1.prv, key1.pub, 5);
+	std::vector<uint8_t> bytes1;
+	{
+		rai::vectorstream stream (bytes1);
+		send1.serialize (stream);
+	}
+	std::vector<uint8_t> bytes2;
+	{
+		rai::vectorstream stream (bytes2);
+		open1.serialize (stream);
+	}
+	bool error1 (false);
+	rai::block_view view1 (error1, rai::block_type::send, bytes1.data (), bytes1.size ());
+	ASSERT_FALSE (error1);
+	ASSERT_EQ (send1.hash (), view1.hash ());
+	ASSERT_EQ (send1.root (), view1.root ());
+	ASSERT_EQ (send1.work, view1.work ());
+	ASSERT_EQ (send1, *view1.block ());
+	bool error2 (false);
+	rai::block_view view2 (error2, rai::block_type::open, bytes2.data (), bytes2.size ());
+	ASSERT_FALSE (error2);
+	ASSERT_EQ (open1.hash (), view2.hash ());
+	ASSERT_EQ (open1.root (), view2.root ());
+	ASSERT_EQ (open1.work, view2.work ());
+	bool error3 (false);
+	rai::block_view view3 (error3, rai::block_type::open, bytes1.data (), bytes1.size ());
+	ASSERT_TRUE (error3);
+	bool error4 (false);
+	rai::block_view view4 (error4, rai::block_type::invalid, bytes1.data (), bytes1.size ());
+	ASSERT_TRUE (error4);
+}
+
+TEST (block, deserialize_shared_pooled)
+{
+	rai::keypair key1;
+	rai::send_block send1 (1, key1.pub, 2, key1.prv, key1.pub, 3);
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		rai::serialize_block (stream, send1);
+	}
+	{
+		rai::bufferstream stream (bytes.data (), bytes.size ());
+		auto block1 (rai::deserialize_block_shared (stream));
+		ASSERT_NE (nullptr, block1);
+		ASSERT_EQ (send1, *block1);
+	}
+	rai::bufferstream stream (bytes.data (), bytes.size () - 1);
+	ASSERT_EQ (nullptr, rai::deserialize_block_shared (stream));
+}
+
+TEST (block, pool_cross_thread)
+{
+	size_t const count (64);
+	rai::keypair key1;
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		for (size_t i (0); i < count; ++i)
+		{
+			rai::send_block send (i, key1.pub, i, key1.prv, key1.pub, i);
+			rai::serialize_block (stream, send);
+		}
+	}
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	auto fresh1 (rai::pool_stats::fresh);
+	auto reused1 (rai::pool_stats::reused);
+	{
+		rai::bufferstream stream (bytes.data (), bytes.size ());
+		for (size_t i (0); i < count; ++i)
+		{
+			blocks.push_back (rai::deserialize_block_shared (stream));
+		}
+	}
+	// Each block shares one pooled allocation with its reference count
+	ASSERT_EQ (count, (rai::pool_stats::fresh - fresh1) + (rai::pool_stats::reused - reused1));
+	// Released on another thread, the way the block processor drops network blocks
+	std::thread ([&blocks]() { blocks.clear (); }).join ();
+	auto fresh2 (rai::pool_stats::fresh);
+	auto reused2 (rai::pool_stats::reused);
+	{
+		rai::bufferstream stream (bytes.data (), bytes.size ());
+		for (size_t i (0); i < count; ++i)
+		{
+			blocks.push_back (rai::deserialize_block_shared (stream));
+		}
+	}
+	ASSERT_EQ (fresh2, rai::pool_stats::fresh);
+	ASSERT_EQ (reused2 + count, rai::pool_stats::reused);
+}
@@ -211,6 +211,44 @@ TEST (unchecked, multiple)
 	ASSERT_FALSE (block4.empty ());
 }
 
+TEST (unchecked, begin_resume)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::keypair key1;
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, key1.prv, key1.pub, 5));
+	auto block2 (std::make_shared<rai::send_block> (4, 1, 3, key1.prv, key1.pub, 5));
+	auto block3 (std::make_shared<rai::send_block> (6, 1, 2, key1.prv, key1.pub, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.unchecked_put (transaction, block2->previous (), block2);
+	store.unchecked_put (transaction, block3->previous (), block3);
+	store.flush (transaction);
+	std::vector<uint8_t> second;
+	{
+		auto i (store.unchecked_begin (transaction));
+		++i;
+		auto data (reinterpret_cast<uint8_t const *> (i->second.data ()));
+		second.assign (data, data + i->second.size ());
+	}
+	{
+		auto i (store.unchecked_begin (transaction, block1->previous (), rai::mdb_val (second.size (), second.data ())));
+		ASSERT_NE (store.unchecked_end (), i);
+		ASSERT_EQ (block1->previous (), rai::block_hash (i->first.uint256 ()));
+		ASSERT_EQ (second, std::vector<uint8_t> (reinterpret_cast<uint8_t const *> (i->second.data ()), reinterpret_cast<uint8_t const *> (i->second.data ()) + i->second.size ()));
+	}
+	// Once the last block under a key is gone the next key follows
+	rai::bufferstream stream (second.data (), second.size ());
+	auto block4 (rai::deserialize_block (stream));
+	store.unchecked_del (transaction, block1->previous (), *block4);
+	{
+		auto i (store.unchecked_begin (transaction, block1->previous (), rai::mdb_val (second.size (), second.data ())));
+		ASSERT_NE (store.unchecked_end (), i);
+		ASSERT_EQ (block3->previous (), rai::block_hash (i->first.uint256 ()));
+	}
+}
+
 TEST (checksum, simple)
 {
 	bool init (false);
@@ -566,11 +604,160 @@ TEST (block_store, block_count)
 	bool init (false);
 	rai::block_store store (init, rai::unique_path ());
 	ASSERT_TRUE (!init);
-	ASSERT_EQ (0, store.block_count (rai::transaction (store.environment, nullptr, false)).sum ());
+	ASSERT_EQ (0, store.block_count ().sum ());
 	rai::open_block block (0, 1, 0, rai::keypair ().prv, 0, 0);
 	rai::uint256_union hash1 (block.hash ());
 	store.block_put (rai::transaction (store.environment, nullptr, true), hash1, block);
-	ASSERT_EQ (1, store.block_count (rai::transaction (store.environment, nullptr, false)).sum ());
+	ASSERT_EQ (1, store.block_count ().sum ());
+}
+
+TEST (block_store, block_count_type)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+	store.block_put (transaction, block1.hash (), block1);
+	rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+	store.block_put (transaction, block2.hash (), block2);
+	store.block_successor_clear (transaction, block1.hash ());
+	auto count1 (store.block_count ());
+	ASSERT_EQ (1, count1.open);
+	ASSERT_EQ (1, count1.send);
+	ASSERT_EQ (0, count1.receive);
+	ASSERT_EQ (0, count1.change);
+	store.block_del (transaction, block2.hash ());
+	auto count2 (store.block_count ());
+	ASSERT_EQ (1, count2.open);
+	ASSERT_EQ (0, count2.send);
+	ASSERT_EQ (1, count2.sum ());
+}
+
+TEST (block_store, block_count_flush)
+{
+	auto path (rai::unique_path ());
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+		store.block_put (transaction, block1.hash (), block1);
+		rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+		store.block_put (transaction, block2.hash (), block2);
+		store.flush (transaction);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	auto count (store.block_count ());
+	ASSERT_EQ (1, count.open);
+	ASSERT_EQ (1, count.send);
+	ASSERT_EQ (2, count.sum ());
+}
+
+TEST (block_store, block_count_recount)
+{
+	auto path (rai::unique_path ());
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+		store.block_put (transaction, block1.hash (), block1);
+		rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+		store.block_put (transaction, block2.hash (), block2);
+		// Closed without writing the counts, as after a crash
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	auto count (store.block_count ());
+	ASSERT_EQ (1, count.open);
+	ASSERT_EQ (1, count.send);
+	ASSERT_EQ (2, count.sum ());
+}
+
+TEST (block_store, block_filter)
+{
+	rai::block_filter filter (1000, 0.01);
+	std::vector<rai::block_hash> hashes (1000);
+	for (auto & hash : hashes)
+	{
+		rai::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
+		filter.insert (hash);
+	}
+	for (auto & hash : hashes)
+	{
+		ASSERT_TRUE (filter.may_contain (hash));
+	}
+	auto false_positives (0);
+	for (auto i (0); i < 10000; ++i)
+	{
+		rai::block_hash hash;
+		rai::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
+		false_positives += filter.may_contain (hash) ? 1 : 0;
+	}
+	ASSERT_GT (500, false_positives);
+}
+
+TEST (block_store, block_filter_rebuild)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+	store.block_put (transaction, block1.hash (), block1);
+	store.block_filter_rebuild (transaction);
+	ASSERT_NE (nullptr, store.block_filter);
+	ASSERT_TRUE (store.block_filter->may_contain (block1.hash ()));
+	ASSERT_TRUE (store.block_exists (transaction, block1.hash ()));
+	rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+	ASSERT_FALSE (store.block_exists (transaction, block2.hash ()));
+	store.block_put (transaction, block2.hash (), block2);
+	ASSERT_TRUE (store.block_filter->may_contain (block2.hash ()));
+	ASSERT_TRUE (store.block_exists (transaction, block2.hash ()));
+	store.block_del (transaction, block2.hash ());
+	ASSERT_FALSE (store.block_exists (transaction, block2.hash ()));
+	ASSERT_EQ (nullptr, store.block_get (transaction, block2.hash ()));
+}
+
+TEST (block_store, block_filter_grow)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	ASSERT_NE (nullptr, store.block_filter);
+	ASSERT_EQ (rai::block_filter::capacity_min, store.block_filter->capacity);
+	// Stand in for a filter the ledger has outgrown
+	std::atomic_store (&store.block_filter, std::make_shared<rai::block_filter> (1, 0.01));
+	rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+	rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+	rai::send_block block3 (block2.hash (), 1, 3, rai::keypair ().prv, 4, 5);
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		store.block_put (transaction, block1.hash (), block1);
+		ASSERT_EQ (nullptr, std::atomic_load (&store.block_filter_next));
+		store.block_put (transaction, block2.hash (), block2);
+		// The larger filter is filled once this transaction commits, the old one stays in use meanwhile
+		ASSERT_NE (nullptr, std::atomic_load (&store.block_filter_next));
+		ASSERT_EQ (1, store.block_filter->capacity);
+		store.block_put (transaction, block3.hash (), block3);
+		ASSERT_TRUE (store.block_exists (transaction, block3.hash ()));
+	}
+	auto deadline (std::chrono::steady_clock::now () + std::chrono::seconds (10));
+	while (std::atomic_load (&store.block_filter_next) != nullptr)
+	{
+		ASSERT_LT (std::chrono::steady_clock::now (), deadline);
+		std::this_thread::sleep_for (std::chrono::milliseconds (1));
+	}
+	ASSERT_EQ (rai::block_filter::capacity_min, store.block_filter->capacity);
+	ASSERT_TRUE (store.block_filter->may_contain (block1.hash ()));
+	ASSERT_TRUE (store.block_filter->may_contain (block2.hash ()));
+	ASSERT_TRUE (store.block_filter->may_contain (block3.hash ()));
 }
 
 TEST (block_store, frontier_count)
@@ -614,6 +801,44 @@ TEST (block_store, sequence_increment)
 	ASSERT_EQ (31, vote6->sequence);
 }
 
+// Sequence numbers survive a flush of every cache shard
+TEST (block_store, sequence_flush_shards)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::open_block> (0, 1, 0, rai::keypair ().prv, 0, 0));
+	std::vector<rai::keypair> keys (64);
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		for (auto & i : keys)
+		{
+			store.vote_generate (transaction, i.pub, i.prv, block1);
+			store.vote_generate (transaction, i.pub, i.prv, block1);
+		}
+		// Written votes stay cached until the write is committed
+		ASSERT_EQ (keys.size (), store.flush (transaction).size ());
+		for (auto & i : keys)
+		{
+			ASSERT_EQ (2, store.vote_current (transaction, i.pub)->sequence);
+		}
+	}
+	store.flush ();
+	for (auto & i : store.vote_cache)
+	{
+		ASSERT_TRUE (i.votes.empty ());
+	}
+	rai::transaction transaction (store.environment, nullptr, true);
+	for (auto & i : keys)
+	{
+		auto vote1 (store.vote_get (transaction, i.pub));
+		ASSERT_NE (nullptr, vote1);
+		ASSERT_EQ (2, vote1->sequence);
+		auto vote2 (store.vote_generate (transaction, i.pub, i.prv, block1));
+		ASSERT_EQ (3, vote2->sequence);
+	}
+}
+
 TEST (block_store, upgrade_v2_v3)
 {
 	rai::keypair key1;
@@ -971,3 +1196,213 @@ TEST (block_store, upgrade_v9_v10)
 	ASSERT_EQ (block_info.account, rai::test_genesis_key.pub);
 	ASSERT_EQ (block_info.balance.number (), rai::genesis_amount - rai::Gxrb_ratio * 31);
 }
+
+TEST (block_store, upgrade_v10_v11)
+{
+	auto path (rai::unique_path ());
+	rai::open_block block1 (0, 1, 0, rai::keypair ().prv, 0, 0);
+	rai::send_block block2 (block1.hash (), 1, 2, rai::keypair ().prv, 4, 5);
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		store.version_put (transaction, 10);
+		MDB_dbi open_blocks;
+		ASSERT_EQ (0, mdb_dbi_open (transaction, "open", MDB_CREATE, &open_blocks));
+		MDB_dbi send_blocks;
+		ASSERT_EQ (0, mdb_dbi_open (transaction, "send", MDB_CREATE, &send_blocks));
+		std::vector<uint8_t> open_data;
+		{
+			rai::vectorstream stream (open_data);
+			block1.serialize (stream);
+			rai::write (stream, block2.hash ().bytes);
+		}
+		ASSERT_EQ (0, mdb_put (transaction, open_blocks, rai::mdb_val (block1.hash ()), rai::mdb_val (open_data.size (), open_data.data ()), 0));
+		std::vector<uint8_t> send_data;
+		{
+			rai::vectorstream stream (send_data);
+			block2.serialize (stream);
+			rai::write (stream, rai::block_hash (0).bytes);
+		}
+		ASSERT_EQ (0, mdb_put (transaction, send_blocks, rai::mdb_val (block2.hash ()), rai::mdb_val (send_data.size (), send_data.data ()), 0));
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (10, store.version_get (transaction));
+	auto block3 (store.block_get (transaction, block1.hash ()));
+	ASSERT_NE (nullptr, block3);
+	ASSERT_EQ (block1, *block3);
+	auto block4 (store.block_get (transaction, block2.hash ()));
+	ASSERT_NE (nullptr, block4);
+	ASSERT_EQ (block2, *block4);
+	ASSERT_EQ (block2.hash (), store.block_successor (transaction, block1.hash ()));
+	auto count (store.block_count ());
+	ASSERT_EQ (1, count.open);
+	ASSERT_EQ (1, count.send);
+	MDB_dbi send_blocks;
+	ASSERT_EQ (MDB_NOTFOUND, mdb_dbi_open (transaction, "send", 0, &send_blocks));
+}
+
+TEST (block_store, upgrade_v11_v12)
+{
+	auto path (rai::unique_path ());
+	std::vector<std::pair<rai::block_hash, rai::uint128_t>> blocks;
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		rai::genesis genesis;
+		genesis.initialize (transaction, store);
+		rai::ledger ledger (store);
+		rai::keypair key1;
+		auto hash (genesis.hash ());
+		rai::uint128_t balance (rai::genesis_amount);
+		blocks.push_back (std::make_pair (hash, balance));
+		for (auto i (0); i < 4; ++i)
+		{
+			balance -= rai::Gxrb_ratio;
+			rai::send_block send (hash, key1.pub, balance, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+			ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+			hash = send.hash ();
+			blocks.push_back (std::make_pair (hash, balance));
+		}
+		ASSERT_EQ (0, mdb_drop (transaction, store.blocks_info, 0));
+		store.version_put (transaction, 11);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (11, store.version_get (transaction));
+	for (auto & i : blocks)
+	{
+		rai::block_info block_info;
+		ASSERT_FALSE (store.block_info_get (transaction, i.first, block_info));
+		ASSERT_EQ (rai::test_genesis_key.pub, block_info.account);
+		ASSERT_EQ (i.second, block_info.balance.number ());
+	}
+}
+
+TEST (block_store, upgrade_v12_v13)
+{
+	auto path (rai::unique_path ());
+	rai::keypair key1;
+	rai::keypair key2;
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		rai::genesis genesis;
+		genesis.initialize (transaction, store);
+		rai::ledger ledger (store);
+		rai::send_block send (genesis.hash (), key1.pub, rai::genesis_amount - rai::Gxrb_ratio, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+		rai::open_block open (send.hash (), key2.pub, key1.pub, key1.prv, key1.pub, 0);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open).code);
+		ASSERT_EQ (0, mdb_drop (transaction, store.delegators, 0));
+		store.version_put (transaction, 12);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (12, store.version_get (transaction));
+	auto i1 (store.delegators_begin (transaction, rai::test_genesis_key.pub));
+	ASSERT_NE (store.delegators_end (), i1);
+	rai::delegator_key key3 (i1->first);
+	ASSERT_EQ (rai::test_genesis_key.pub, key3.representative);
+	ASSERT_EQ (rai::test_genesis_key.pub, key3.account);
+	auto i2 (store.delegators_begin (transaction, key2.pub));
+	ASSERT_NE (store.delegators_end (), i2);
+	rai::delegator_key key4 (i2->first);
+	ASSERT_EQ (key2.pub, key4.representative);
+	ASSERT_EQ (key1.pub, key4.account);
+	auto count (0);
+	for (auto i (store.delegators_begin (transaction, rai::account (0))), n (store.delegators_end ()); i != n; ++i)
+	{
+		++count;
+	}
+	ASSERT_EQ (2, count);
+}
+
+TEST (block_store, block_representative)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::keypair key1;
+	rai::change_block change1 (0, key1.pub, rai::keypair ().prv, 0, 0);
+	store.block_put (transaction, change1.hash (), change1);
+	ASSERT_EQ (key1.pub, store.block_representative (transaction, change1.hash ()));
+	ASSERT_EQ (1, store.representative_cache.size ());
+	ASSERT_EQ (key1.pub, store.block_representative (transaction, change1.hash ()));
+	ASSERT_EQ (1, store.representative_cache.size ());
+	store.block_del (transaction, change1.hash ());
+	ASSERT_EQ (0, store.representative_cache.size ());
+}
+
+TEST (block_store, representation_top)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::keypair key1;
+	rai::keypair key2;
+	rai::keypair key3;
+	store.representation_put (transaction, key1.pub, 100);
+	store.representation_put (transaction, key2.pub, 300);
+	store.representation_put (transaction, key3.pub, 200);
+	auto top1 (store.representation_top (2));
+	ASSERT_EQ (2, top1.size ());
+	ASSERT_EQ (key2.pub, top1[0].representative);
+	ASSERT_EQ (300, top1[0].weight);
+	ASSERT_EQ (key3.pub, top1[1].representative);
+	store.representation_put (transaction, key1.pub, 500);
+	store.representation_put (transaction, key2.pub, 0);
+	auto top2 (store.representation_top (std::numeric_limits<size_t>::max ()));
+	ASSERT_EQ (3, top2.size ());
+	ASSERT_EQ (key1.pub, top2[0].representative);
+	ASSERT_EQ (500, top2[0].weight);
+	ASSERT_EQ (key3.pub, top2[1].representative);
+	// Representatives without weight are still listed, last
+	ASSERT_EQ (key2.pub, top2[2].representative);
+	ASSERT_EQ (0, top2[2].weight);
+	store.representation_cache_load (transaction);
+	auto top3 (store.representation_top (std::numeric_limits<size_t>::max ()));
+	ASSERT_EQ (3, top3.size ());
+	ASSERT_EQ (key1.pub, top3[0].representative);
+	ASSERT_EQ (key2.pub, top3[2].representative);
+}
+
+TEST (block_store, representation_top_ties)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	// Equal weights are listed in account order whatever order they were written in
+	store.representation_put (transaction, 3, 100);
+	store.representation_put (transaction, 1, 100);
+	store.representation_put (transaction, 4, 200);
+	store.representation_put (transaction, 2, 100);
+	auto top1 (store.representation_top (std::numeric_limits<size_t>::max ()));
+	ASSERT_EQ (4, top1.size ());
+	ASSERT_EQ (rai::account (4), top1[0].representative);
+	ASSERT_EQ (rai::account (1), top1[1].representative);
+	ASSERT_EQ (rai::account (2), top1[2].representative);
+	ASSERT_EQ (rai::account (3), top1[3].representative);
+	store.representation_put (transaction, 4, 100);
+	store.representation_cache_load (transaction);
+	auto top2 (store.representation_top (3));
+	ASSERT_EQ (3, top2.size ());
+	ASSERT_EQ (rai::account (1), top2[0].representative);
+	ASSERT_EQ (rai::account (2), top2[1].representative);
+	ASSERT_EQ (rai::account (3), top2[2].representative);
+}
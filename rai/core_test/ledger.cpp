@@ -844,6 +844,32 @@ TEST (votes, add_old)
 	ASSERT_EQ (*send1, *winner.second);
 }
 
+// Running totals follow reps changing their vote
+TEST (votes, running_totals)
+{
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto send2 (std::make_shared<rai::send_block> (genesis.hash (), key2.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	rai::votes votes1 (send1);
+	ASSERT_EQ (1, votes1.totals.size ());
+	ASSERT_EQ (0, votes1.winner ().first);
+	ASSERT_EQ (rai::tally_result::vote, votes1.vote (std::make_shared<rai::vote> (key1.pub, key1.prv, 1, send1), 100));
+	ASSERT_EQ (rai::tally_result::vote, votes1.vote (std::make_shared<rai::vote> (key2.pub, key2.prv, 1, send2), 150));
+	ASSERT_EQ (2, votes1.totals.size ());
+	auto winner1 (votes1.winner ());
+	ASSERT_EQ (150, winner1.first);
+	ASSERT_EQ (*send2, *winner1.second);
+	ASSERT_EQ (rai::tally_result::changed, votes1.vote (std::make_shared<rai::vote> (key2.pub, key2.prv, 2, send1), 150));
+	ASSERT_EQ (1, votes1.totals.size ());
+	auto winner2 (votes1.winner ());
+	ASSERT_EQ (250, winner2.first);
+	ASSERT_EQ (*send1, *winner2.second);
+	ASSERT_EQ (rai::tally_result::confirm, votes1.vote (std::make_shared<rai::vote> (key1.pub, key1.prv, 2, send1), 50));
+	ASSERT_EQ (200, votes1.winner ().first);
+}
+
 // Query for block successor
 TEST (ledger, successor)
 {
@@ -1364,6 +1390,42 @@ TEST (ledger, change_representative_move_representation)
 	ASSERT_EQ (rai::genesis_amount, ledger.weight (transaction, key3.pub));
 }
 
+TEST (ledger, delegators_index)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::ledger ledger (store);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	auto delegators ([&store, &transaction](rai::account const & representative_a) -> std::vector<rai::account> {
+		std::vector<rai::account> result;
+		for (auto i (store.delegators_begin (transaction, representative_a)), n (store.delegators_end ()); i != n && rai::delegator_key (i->first).representative == representative_a; ++i)
+		{
+			result.push_back (rai::delegator_key (i->first).account);
+		}
+		return result;
+	});
+	ASSERT_EQ (std::vector<rai::account> (1, rai::test_genesis_key.pub), delegators (rai::test_genesis_key.pub));
+	rai::keypair key1;
+	rai::send_block send (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+	rai::open_block open (send.hash (), key1.pub, key1.pub, key1.prv, key1.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open).code);
+	ASSERT_EQ (std::vector<rai::account> (1, key1.pub), delegators (key1.pub));
+	rai::keypair key2;
+	rai::change_block change (send.hash (), key2.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, change).code);
+	ASSERT_TRUE (delegators (rai::test_genesis_key.pub).empty ());
+	ASSERT_EQ (std::vector<rai::account> (1, rai::test_genesis_key.pub), delegators (key2.pub));
+	ledger.rollback (transaction, change.hash ());
+	ASSERT_TRUE (delegators (key2.pub).empty ());
+	ASSERT_EQ (std::vector<rai::account> (1, rai::test_genesis_key.pub), delegators (rai::test_genesis_key.pub));
+	ledger.rollback (transaction, open.hash ());
+	ASSERT_TRUE (delegators (key1.pub).empty ());
+}
+
 TEST (ledger, send_open_receive_rollback)
 {
 	bool init (false);
@@ -1420,3 +1482,81 @@ TEST (ledger, send_open_receive_rollback)
 	ASSERT_EQ (0, ledger.weight (transaction, key3.pub));
 	ASSERT_EQ (rai::genesis_amount - 0, ledger.weight (transaction, rai::test_genesis_key.pub));
 }
+
+TEST (ledger, process_verified)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_FALSE (init);
+	rai::ledger ledger (store);
+	rai::genesis genesis;
+	rai::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	rai::keypair key1;
+	rai::change_block block (genesis.hash (), key1.pub, rai::keypair ().prv, 0, 0);
+	// Signature was checked against a different account so it must be verified again
+	ASSERT_EQ (rai::process_result::bad_signature, ledger.process (transaction, block, key1.pub).code);
+	// A block verified against the signing account is trusted
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, block, rai::test_genesis_key.pub).code);
+}
+
+TEST (ledger, block_info_index)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::ledger ledger (store);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	rai::block_info info1;
+	ASSERT_FALSE (store.block_info_get (transaction, genesis.hash (), info1));
+	ASSERT_EQ (rai::test_genesis_key.pub, info1.account);
+	ASSERT_EQ (rai::genesis_amount, info1.balance.number ());
+	rai::keypair key1;
+	rai::send_block send1 (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send1).code);
+	rai::open_block open1 (send1.hash (), key1.pub, key1.pub, key1.prv, key1.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open1).code);
+	rai::block_info info2;
+	ASSERT_FALSE (store.block_info_get (transaction, send1.hash (), info2));
+	ASSERT_EQ (rai::test_genesis_key.pub, info2.account);
+	ASSERT_EQ (rai::genesis_amount - 100, info2.balance.number ());
+	rai::block_info info3;
+	ASSERT_FALSE (store.block_info_get (transaction, open1.hash (), info3));
+	ASSERT_EQ (key1.pub, info3.account);
+	ASSERT_EQ (100, info3.balance.number ());
+	ASSERT_EQ (key1.pub, ledger.account (transaction, open1.hash ()));
+	ASSERT_EQ (100, ledger.balance (transaction, open1.hash ()));
+	ledger.rollback (transaction, send1.hash ());
+	ASSERT_FALSE (store.block_info_exists (transaction, send1.hash ()));
+	ASSERT_FALSE (store.block_info_exists (transaction, open1.hash ()));
+	ASSERT_TRUE (store.block_info_exists (transaction, genesis.hash ()));
+}
+
+TEST (ledger, weight_cache)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::ledger ledger (store);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	ASSERT_EQ (rai::genesis_amount, ledger.weight (rai::test_genesis_key.pub));
+	rai::keypair key1;
+	rai::change_block change1 (genesis.hash (), key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, change1).code);
+	ASSERT_EQ (0, ledger.weight (rai::test_genesis_key.pub));
+	ASSERT_EQ (rai::genesis_amount, ledger.weight (key1.pub));
+	ledger.rollback (transaction, change1.hash ());
+	ASSERT_EQ (rai::genesis_amount, ledger.weight (rai::test_genesis_key.pub));
+	ASSERT_EQ (0, ledger.weight (key1.pub));
+	store.representation_cache_minimum = 1000;
+	rai::keypair key2;
+	store.representation_put (transaction, key2.pub, 10);
+	ASSERT_EQ (0, ledger.weight (key2.pub));
+	ASSERT_EQ (10, ledger.weight (transaction, key2.pub));
+	store.representation_put (transaction, key2.pub, 1000);
+	ASSERT_EQ (1000, ledger.weight (key2.pub));
+}
@@ -151,3 +151,66 @@ TEST (message_parser, exact_keepalive_size)
 	ASSERT_EQ (1, visitor.keepalive_count);
 	ASSERT_TRUE (parser.error);
 }
+
+TEST (message_parser, duplicate_filter)
+{
+	rai::system system (24000, 1);
+	test_visitor visitor;
+	rai::message_filter filter (16);
+	rai::message_parser parser (visitor, system.work, &filter);
+	auto block (std::unique_ptr<rai::send_block> (new rai::send_block (1, 1, 2, rai::keypair ().prv, 4, system.work.generate (1))));
+	auto vote (std::make_shared<rai::vote> (0, rai::keypair ().prv, 0, std::move (block)));
+	rai::confirm_ack message (vote);
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		message.serialize (stream);
+	}
+	parser.deserialize_buffer (bytes.data (), bytes.size ());
+	ASSERT_EQ (1, visitor.confirm_ack_count);
+	ASSERT_FALSE (parser.duplicate);
+	// A relay by a peer using a different protocol version is still the same message
+	bytes[3] = bytes[3] - 1;
+	parser.deserialize_buffer (bytes.data (), bytes.size ());
+	ASSERT_EQ (1, visitor.confirm_ack_count);
+	ASSERT_TRUE (parser.duplicate);
+	ASSERT_FALSE (parser.error);
+	ASSERT_EQ (1, filter.hits);
+	ASSERT_EQ (1, filter.misses);
+	rai::keepalive keepalive;
+	std::vector<uint8_t> keepalive_bytes;
+	{
+		rai::vectorstream stream (keepalive_bytes);
+		keepalive.serialize (stream);
+	}
+	parser.deserialize_buffer (keepalive_bytes.data (), keepalive_bytes.size ());
+	parser.deserialize_buffer (keepalive_bytes.data (), keepalive_bytes.size ());
+	ASSERT_EQ (2, visitor.keepalive_count);
+	ASSERT_EQ (1, filter.hits);
+}
+
+TEST (message_parser, duplicate_filter_remove)
+{
+	rai::system system (24000, 1);
+	test_visitor visitor;
+	rai::message_filter filter (16);
+	rai::message_parser parser (visitor, system.work, &filter);
+	auto block (std::unique_ptr<rai::send_block> (new rai::send_block (1, 1, 2, rai::keypair ().prv, 4, system.work.generate (1))));
+	auto vote (std::make_shared<rai::vote> (0, rai::keypair ().prv, 0, std::move (block)));
+	rai::confirm_ack message (vote);
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		message.serialize (stream);
+	}
+	parser.deserialize_buffer (bytes.data (), bytes.size ());
+	ASSERT_EQ (1, visitor.confirm_ack_count);
+	// A message that couldn't be handled is let through again
+	filter.remove (bytes.data (), bytes.size ());
+	parser.deserialize_buffer (bytes.data (), bytes.size ());
+	ASSERT_EQ (2, visitor.confirm_ack_count);
+	ASSERT_FALSE (parser.duplicate);
+	parser.deserialize_buffer (bytes.data (), bytes.size ());
+	ASSERT_EQ (2, visitor.confirm_ack_count);
+	ASSERT_TRUE (parser.duplicate);
+}
@@ -52,12 +52,39 @@ TEST (network, construction)
 TEST (network, self_discard)
 {
 	rai::system system (24000, 1);
-	system.nodes[0]->network.remote = system.nodes[0]->network.endpoint ();
 	ASSERT_EQ (0, system.nodes[0]->network.bad_sender_count);
-	system.nodes[0]->network.receive_action (boost::system::error_code{}, 0);
+	system.nodes[0]->network.receive_packet (nullptr, 0, system.nodes[0]->network.endpoint ());
 	ASSERT_EQ (1, system.nodes[0]->network.bad_sender_count);
 }
 
+TEST (network, multiple_receivers)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.receive_sockets = 4;
+	config1.receive_batch_size = 8;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_EQ (4, node1->network.receivers.size ());
+	for (auto & i : node1->network.receivers)
+	{
+		ASSERT_EQ (24001, i->socket.local_endpoint ().port ());
+	}
+	node1->start ();
+	for (auto i (0); i < 8; ++i)
+	{
+		system.nodes[0]->network.send_keepalive (node1->network.endpoint ());
+	}
+	auto iterations (0);
+	while (node1->network.incoming.keepalive.load () < 8)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	node1->stop ();
+}
+
 TEST (network, send_keepalive)
 {
 	rai::system system (24000, 1);
@@ -86,6 +113,36 @@ TEST (network, send_keepalive)
 	node1->stop ();
 }
 
+TEST (network, send_buffer_many)
+{
+	rai::system system (24000, 3);
+	rai::keepalive message;
+	std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+	{
+		rai::vectorstream stream (*bytes);
+		message.serialize (stream);
+	}
+	auto endpoints (std::make_shared<std::vector<rai::endpoint>> ());
+	endpoints->push_back (system.nodes[1]->network.endpoint ());
+	endpoints->push_back (system.nodes[2]->network.endpoint ());
+	auto initial1 (system.nodes[1]->network.incoming.keepalive.load ());
+	auto initial2 (system.nodes[2]->network.incoming.keepalive.load ());
+	std::atomic<int> sent (0);
+	system.nodes[0]->network.send_buffer_many (bytes, endpoints, [&sent](boost::system::error_code const & ec, rai::endpoint const &) {
+		if (!ec)
+		{
+			++sent;
+		}
+	});
+	auto iterations (0);
+	while (sent < 2 || system.nodes[1]->network.incoming.keepalive == initial1 || system.nodes[2]->network.incoming.keepalive == initial2)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+}
+
 TEST (network, keepalive_ipv4)
 {
 	rai::system system (24000, 1);
@@ -484,6 +541,96 @@ TEST (bulk_pull, get_next_on_open)
 	ASSERT_EQ (request->current, request->request->end);
 }
 
+TEST (bulk_pull, get_next_buffer)
+{
+	rai::system system (24000, 1);
+	rai::keypair key2;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	auto send1 (system.wallet (0)->send_action (rai::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, send1);
+	auto connection (std::make_shared<rai::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<rai::bulk_pull> req (new rai::bulk_pull{});
+	req->start = rai::test_genesis_key.pub;
+	req->end.clear ();
+	connection->requests.push (std::unique_ptr<rai::message>{});
+	auto request (std::make_shared<rai::bulk_pull_server> (connection, std::move (req)));
+	std::vector<uint8_t> buffer;
+	ASSERT_FALSE (request->get_next (buffer));
+	ASSERT_FALSE (request->get_next (buffer));
+	ASSERT_TRUE (request->get_next (buffer));
+	ASSERT_EQ (2 + rai::send_block::size + rai::open_block::size, buffer.size ());
+	// Blocks are written newest first in the same format as serialize_block
+	rai::bufferstream stream (buffer.data (), buffer.size ());
+	auto block1 (rai::deserialize_block (stream));
+	ASSERT_NE (nullptr, block1);
+	ASSERT_EQ (*send1, *block1);
+	auto block2 (rai::deserialize_block (stream));
+	ASSERT_NE (nullptr, block2);
+	rai::genesis genesis;
+	ASSERT_EQ (genesis.hash (), block2->hash ());
+}
+
+TEST (bulk_pull, received_buffer)
+{
+	rai::system system (24000, 1);
+	auto node (system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::send_block send1 (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	rai::send_block send2 (send1.hash (), key1.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1.hash ()));
+	rai::send_block send3 (send2.hash (), key1.pub, rai::genesis_amount - 300, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send2.hash ()));
+	// Newest first, terminated by not_a_block and followed by bytes that must be left alone
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		rai::serialize_block (stream, send3);
+		rai::serialize_block (stream, send2);
+		rai::serialize_block (stream, send1);
+		rai::write (stream, rai::block_type::not_a_block);
+		rai::write (stream, rai::block_type::send);
+		rai::write (stream, send1.hashables.previous);
+	}
+	auto attempt (std::make_shared<rai::bootstrap_attempt> (node));
+	auto connection (std::make_shared<rai::bootstrap_client> (node, attempt, rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), 24000)));
+	// Keep received_buffer from issuing further reads or pooling the connection
+	connection->stop (true);
+	std::shared_ptr<rai::bulk_pull_client> client;
+	{
+		std::lock_guard<std::mutex> lock (attempt->mutex);
+		client = std::make_shared<rai::bulk_pull_client> (connection);
+	}
+	client->pull.account = rai::test_genesis_key.pub;
+	client->pull.head = send3.hash ();
+	client->pull.end = genesis.hash ();
+	client->expected = send3.hash ();
+	size_t position (0);
+	auto receive ([&client, &bytes, &position](size_t size_a) {
+		std::copy (bytes.begin () + position, bytes.begin () + position + size_a, client->buffer.begin () + client->buffered);
+		position += size_a;
+		client->received_buffer (boost::system::error_code (), size_a);
+	});
+	// First block split across two reads, the start is carried over
+	receive (1 + rai::send_block::size - 10);
+	ASSERT_EQ (1 + rai::send_block::size - 10, client->buffered);
+	ASSERT_EQ (0, attempt->total_blocks.load ());
+	ASSERT_EQ (send3.hash (), client->expected);
+	receive (5);
+	ASSERT_EQ (1 + rai::send_block::size - 5, client->buffered);
+	ASSERT_EQ (0, attempt->total_blocks.load ());
+	// The rest of the first block and two more whole blocks in one read, followed by not_a_block mid-buffer
+	receive (bytes.size () - position);
+	// Nothing after not_a_block is framed
+	ASSERT_EQ (1 + sizeof (rai::block_hash), client->buffered);
+	ASSERT_EQ (static_cast<uint8_t> (rai::block_type::send), client->buffer[0]);
+	// The blocks are parsed on the block processor thread
+	node->block_processor.flush ();
+	ASSERT_EQ (3, attempt->total_blocks.load ());
+	ASSERT_EQ (3, connection->block_count.load ());
+	ASSERT_EQ (genesis.hash (), client->expected);
+	rai::transaction transaction (node->store.environment, nullptr, false);
+	ASSERT_TRUE (node->store.block_exists (transaction, send3.hash ()));
+}
+
 TEST (bootstrap_processor, DISABLED_process_none)
 {
 	rai::system system (24000, 1);
@@ -735,6 +882,36 @@ TEST (frontier_req, time_cutoff)
 	ASSERT_EQ (genesis.hash (), request->info.head);
 }
 
+TEST (frontier_req, next_cursor)
+{
+	rai::system system (24000, 1);
+	rai::account account1 (rai::test_genesis_key.pub.number () + 1);
+	rai::account account2 (rai::test_genesis_key.pub.number () + 2);
+	rai::account account3 (rai::test_genesis_key.pub.number () + 3);
+	auto now (rai::seconds_since_epoch ());
+	{
+		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, true);
+		system.nodes[0]->store.account_put (transaction, account1, { 1, 1, 1, 0, now, 1 });
+		system.nodes[0]->store.account_put (transaction, account2, { 2, 2, 2, 0, 0, 1 });
+		system.nodes[0]->store.account_put (transaction, account3, { 3, 3, 3, 0, now, 1 });
+	}
+	auto connection (std::make_shared<rai::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<rai::frontier_req> req (new rai::frontier_req);
+	req->start = account1;
+	req->age = 10;
+	req->count = std::numeric_limits<decltype (req->count)>::max ();
+	connection->requests.push (std::unique_ptr<rai::message>{});
+	auto request (std::make_shared<rai::frontier_req_server> (connection, std::move (req)));
+	ASSERT_EQ (account1, request->current);
+	rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
+	auto iterator (system.nodes[0]->store.latest_begin (transaction, account1.number () + 1));
+	request->next (iterator);
+	ASSERT_EQ (account3, request->current);
+	ASSERT_EQ (rai::block_hash (3), request->info.head);
+	request->next (iterator);
+	ASSERT_TRUE (request->current.is_zero ());
+}
+
 TEST (bulk, genesis)
 {
 	rai::system system (24000, 1);
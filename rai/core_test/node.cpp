@@ -66,6 +66,54 @@ TEST (node, balance)
 	ASSERT_EQ (std::numeric_limits<rai::uint128_t>::max (), system.nodes[0]->ledger.account_balance (transaction, rai::test_genesis_key.pub));
 }
 
+// Weights outside vote tallying include representatives too small for the in-memory cache
+TEST (node, weight_uncached)
+{
+	rai::system system (24000, 1);
+	auto & node (*system.nodes[0]);
+	node.store.representation_cache_minimum = std::numeric_limits<rai::uint128_t>::max ();
+	rai::keypair key1;
+	{
+		rai::transaction transaction (node.store.environment, nullptr, true);
+		node.store.representation_put (transaction, key1.pub, 10);
+	}
+	ASSERT_EQ (0, node.ledger.weight (key1.pub));
+	ASSERT_EQ (10, node.weight (key1.pub));
+}
+
+TEST (node, vote_weight_uncached)
+{
+	rai::system system (24000, 1);
+	auto & node (*system.nodes[0]);
+	node.store.representation_cache_minimum = std::numeric_limits<rai::uint128_t>::max ();
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	{
+		rai::transaction transaction (node.store.environment, nullptr, true);
+		node.store.representation_put (transaction, key1.pub, 10);
+		node.active.start (transaction, send1);
+	}
+	node.active.vote (std::make_shared<rai::vote> (key1.pub, key1.prv, 1, send1));
+	auto election (node.active.roots.find (send1->root ())->election);
+	auto existing (election->votes.rep_weights.find (key1.pub));
+	ASSERT_NE (election->votes.rep_weights.end (), existing);
+	ASSERT_EQ (10, existing->second);
+}
+
+TEST (node, duplicate)
+{
+	rai::system system (24000, 1);
+	rai::genesis genesis;
+	ASSERT_NE (nullptr, system.nodes[0]->store.block_filter);
+	ASSERT_TRUE (system.nodes[0]->duplicate (*genesis.open));
+	rai::keypair key1;
+	rai::send_block send1 (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	ASSERT_FALSE (system.nodes[0]->duplicate (send1));
+	ASSERT_EQ (rai::process_result::progress, system.nodes[0]->process (send1).code);
+	ASSERT_TRUE (system.nodes[0]->duplicate (send1));
+}
+
 TEST (node, representative)
 {
 	rai::system system (24000, 1);
@@ -495,6 +543,10 @@ TEST (node_config, serialization)
 	config1.callback_port = 10;
 	config1.callback_target = "test";
 	config1.lmdb_max_dbs = 256;
+	config1.signature_checker_threads = 0;
+	config1.receive_sockets = 3;
+	config1.receive_batch_size = 16;
+	config1.block_filter_fp_rate = 0.5;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	rai::logging logging2;
@@ -510,6 +562,10 @@ TEST (node_config, serialization)
 	ASSERT_NE (config2.callback_address, config1.callback_address);
 	ASSERT_NE (config2.callback_port, config1.callback_port);
 	ASSERT_NE (config2.callback_target, config1.callback_target);
+	ASSERT_NE (config2.signature_checker_threads, config1.signature_checker_threads);
+	ASSERT_NE (config2.receive_sockets, config1.receive_sockets);
+	ASSERT_NE (config2.receive_batch_size, config1.receive_batch_size);
+	ASSERT_NE (config2.block_filter_fp_rate, config1.block_filter_fp_rate);
 
 	bool upgraded (false);
 	config2.deserialize_json (upgraded, tree);
@@ -524,6 +580,10 @@ TEST (node_config, serialization)
 	ASSERT_EQ (config2.callback_port, config1.callback_port);
 	ASSERT_EQ (config2.callback_target, config1.callback_target);
 	ASSERT_EQ (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
+	ASSERT_EQ (config2.signature_checker_threads, config1.signature_checker_threads);
+	ASSERT_EQ (config2.receive_sockets, config1.receive_sockets);
+	ASSERT_EQ (config2.receive_batch_size, config1.receive_batch_size);
+	ASSERT_EQ (config2.block_filter_fp_rate, config1.block_filter_fp_rate);
 }
 
 TEST (node_config, v1_v2_upgrade)
@@ -1410,7 +1470,6 @@ TEST (node, vote_replay)
 	}
 	{
 		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
-		std::lock_guard<std::mutex> lock (system.nodes[0]->store.cache_mutex);
 		auto vote (system.nodes[0]->store.vote_current (transaction, rai::test_genesis_key.pub));
 		ASSERT_EQ (nullptr, vote);
 	}
@@ -1423,7 +1482,6 @@ TEST (node, vote_replay)
 	{
 		system.poll ();
 		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
-		std::lock_guard<std::mutex> lock (system.nodes[0]->store.cache_mutex);
 		auto vote (system.nodes[0]->store.vote_current (transaction, rai::test_genesis_key.pub));
 		done = vote && (vote->sequence >= 10000);
 		++iterations;
@@ -1480,3 +1538,238 @@ TEST (node, bootstrap_connection_scaling)
 	ASSERT_EQ (1, attempt->target_connections (0));
 	ASSERT_EQ (1, attempt->target_connections (50000));
 }
+
+TEST (signature_checker, batch)
+{
+	rai::signature_checker checker (2);
+	std::vector<rai::public_key> keys;
+	std::vector<rai::uint256_union> messages;
+	std::vector<rai::signature> signatures;
+	for (auto i (0); i < 200; ++i)
+	{
+		rai::keypair key;
+		rai::uint256_union message (i);
+		keys.push_back (key.pub);
+		messages.push_back (message);
+		signatures.push_back (rai::sign_message (key.prv, key.pub, message));
+	}
+	signatures[7].bytes[0] ^= 1;
+	signatures[150].bytes[0] ^= 1;
+	std::vector<int> valid;
+	checker.verify (keys, messages, signatures, valid);
+	ASSERT_EQ (200, valid.size ());
+	for (auto i (0); i < 200; ++i)
+	{
+		ASSERT_EQ ((i == 7 || i == 150) ? 0 : 1, valid[i]);
+	}
+}
+
+TEST (signature_checker, no_threads)
+{
+	rai::signature_checker checker (0);
+	rai::keypair key;
+	rai::uint256_union message (1);
+	std::vector<rai::public_key> keys (1, key.pub);
+	std::vector<rai::uint256_union> messages (1, message);
+	std::vector<rai::signature> signatures (1, rai::sign_message (key.prv, key.pub, message));
+	std::vector<int> valid;
+	checker.verify (keys, messages, signatures, valid);
+	ASSERT_EQ (1, valid[0]);
+}
+
+TEST (block_processor, verify)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto open (std::make_shared<rai::open_block> (send1->hash (), key.pub, key.pub, key.prv, key.pub, 0));
+	auto bad (std::make_shared<rai::send_block> (send2->hash (), key.pub, 0, key.prv, key.pub, 0));
+	std::deque<rai::block_processor_item> items;
+	items.push_back (rai::block_processor_item (send1));
+	items.push_back (rai::block_processor_item (send2));
+	items.push_back (rai::block_processor_item (open));
+	items.push_back (rai::block_processor_item (bad));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.block_processor.verify (transaction, items);
+	}
+	// The block signed by the wrong account is dropped before reaching the ledger
+	ASSERT_EQ (3, items.size ());
+	ASSERT_EQ (rai::test_genesis_key.pub, items[0].verified);
+	ASSERT_EQ (rai::test_genesis_key.pub, items[1].verified);
+	ASSERT_EQ (key.pub, items[2].verified);
+	ASSERT_EQ (1, node1.block_processor.bad_signatures.load ());
+}
+
+TEST (block_processor, verify_unchecked)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.store.unchecked_put (transaction, send1->hash (), send2);
+	}
+	std::deque<rai::block_processor_item> items;
+	items.push_back (rai::block_processor_item (send1));
+	std::unordered_set<rai::block_hash> pulled;
+	{
+		// Pulling waiting blocks in only needs a read transaction
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.block_processor.verify (transaction, items, pulled);
+	}
+	ASSERT_EQ (2, items.size ());
+	ASSERT_EQ (rai::test_genesis_key.pub, items[1].verified);
+	ASSERT_EQ (1, pulled.count (send2->hash ()));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		ASSERT_EQ (1, node1.store.unchecked_get (transaction, send1->hash ()).size ());
+	}
+	// The write pass deletes the row and doesn't queue send2 a second time
+	node1.block_processor.process_receive_many (items);
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_EQ (send2->hash (), node1.ledger.latest (transaction, rai::test_genesis_key.pub));
+	ASSERT_TRUE (node1.store.unchecked_get (transaction, send1->hash ()).empty ());
+}
+
+TEST (block_processor, add_write)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	std::atomic<bool> done (false);
+	node1.block_processor.add_write ([&node1, &done, &genesis](MDB_txn * transaction_a) {
+		ASSERT_NE (nullptr, transaction_a);
+		ASSERT_TRUE (node1.store.block_exists (transaction_a, genesis.hash ()));
+		done = true;
+	});
+	node1.block_processor.flush ();
+	ASSERT_TRUE (done);
+}
+
+TEST (block_processor, add_write_committed)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::keypair key1;
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.store.vote_generate (transaction, key1.pub, key1.prv, std::make_shared<rai::send_block> (0, 1, 2, key1.prv, key1.pub, 3));
+	}
+	std::atomic<bool> done (false);
+	auto written (std::make_shared<std::vector<std::shared_ptr<rai::vote>>> ());
+	node1.block_processor.add_write ([&node1, written](MDB_txn * transaction_a) {
+		*written = node1.store.flush (transaction_a);
+	},
+	[&node1, &done, written, &key1]() {
+		// Still cached until flushed, and the table already holds it
+		auto & shard (node1.store.vote_shard (key1.pub));
+		{
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			ASSERT_NE (shard.votes.end (), shard.votes.find (key1.pub));
+		}
+		{
+			rai::transaction transaction (node1.store.environment, nullptr, false);
+			ASSERT_NE (nullptr, node1.store.vote_get (transaction, key1.pub));
+		}
+		node1.store.flushed (*written);
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		ASSERT_EQ (shard.votes.end (), shard.votes.find (key1.pub));
+		done = true;
+	});
+	node1.block_processor.flush ();
+	ASSERT_TRUE (done);
+}
+
+TEST (block_processor, batch_time)
+{
+	rai::system system (24000, 1);
+	auto & processor (system.nodes[0]->block_processor);
+	processor.commit_latency = std::chrono::milliseconds (0);
+	ASSERT_EQ (rai::block_processor::batch_time_min, processor.batch_time (0));
+	processor.commit_latency = std::chrono::milliseconds (5);
+	ASSERT_EQ (std::chrono::milliseconds (50), processor.batch_time (1));
+	ASSERT_EQ (std::chrono::milliseconds (200), processor.batch_time (rai::block_processor::batch_queue_deep));
+	processor.commit_latency = std::chrono::seconds (1);
+	ASSERT_EQ (rai::transaction_timeout, processor.batch_time (1));
+}
+
+TEST (vote_processor, add)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *send1).code);
+		node1.active.start (transaction, send1);
+	}
+	auto election (node1.active.roots.find (send1->root ())->election);
+	ASSERT_EQ (1, election->votes.rep_votes.size ());
+	// Signed by the wrong key
+	auto vote1 (std::make_shared<rai::vote> (rai::test_genesis_key.pub, key1.prv, 1, send1));
+	node1.vote_processor.add (vote1, rai::endpoint ());
+	node1.vote_processor.flush ();
+	ASSERT_EQ (1, election->votes.rep_votes.size ());
+	auto vote2 (std::make_shared<rai::vote> (rai::test_genesis_key.pub, rai::test_genesis_key.prv, 1, send1));
+	node1.vote_processor.add (vote2, rai::endpoint ());
+	node1.vote_processor.flush ();
+	ASSERT_EQ (2, election->votes.rep_votes.size ());
+	ASSERT_NE (election->votes.rep_votes.end (), election->votes.rep_votes.find (rai::test_genesis_key.pub));
+}
+
+TEST (active_transactions, vote_batch)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.active.start (transaction, send1);
+		node1.active.start (transaction, send2);
+	}
+	ASSERT_EQ (2, node1.active.roots.size ());
+	std::vector<std::shared_ptr<rai::vote>> votes;
+	votes.push_back (std::make_shared<rai::vote> (key1.pub, key1.prv, 1, send1));
+	votes.push_back (std::make_shared<rai::vote> (key1.pub, key1.prv, 2, send2));
+	votes.push_back (std::make_shared<rai::vote> (key2.pub, key2.prv, 1, send1));
+	node1.active.vote (votes);
+	auto election1 (node1.active.roots.find (send1->root ())->election);
+	auto election2 (node1.active.roots.find (send2->root ())->election);
+	ASSERT_EQ (3, election1->votes.rep_votes.size ());
+	ASSERT_NE (election1->votes.rep_votes.end (), election1->votes.rep_votes.find (key2.pub));
+	ASSERT_EQ (2, election2->votes.rep_votes.size ());
+	ASSERT_NE (election2->votes.rep_votes.end (), election2->votes.rep_votes.find (key1.pub));
+}
+
+TEST (block_processor, add_batch)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ())));
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key1.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ())));
+	std::deque<rai::block_processor_item> items;
+	items.push_back (rai::block_processor_item (send1));
+	items.push_back (rai::block_processor_item (send2));
+	node1.block_processor.add (items);
+	ASSERT_TRUE (items.empty ());
+	node1.block_processor.flush ();
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_TRUE (node1.store.block_exists (transaction, send1->hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, send2->hash ()));
+	ASSERT_EQ (send2->hash (), node1.ledger.latest (transaction, rai::test_genesis_key.pub));
+}
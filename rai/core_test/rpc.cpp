@@ -823,6 +823,88 @@ TEST (rpc, frontier_startpoint)
 	ASSERT_EQ (source.begin ()->first.to_account (), frontiers_node.begin ()->first);
 }
 
+TEST (rpc, frontier_chunked)
+{
+	rai::system system (24000, 1);
+	{
+		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, true);
+		for (auto i (0); i < 1000; ++i)
+		{
+			rai::keypair key;
+			system.nodes[0]->store.account_put (transaction, key.pub, rai::account_info (key.prv.data, 0, 0, 0, 0, 0));
+		}
+	}
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "frontiers");
+	request.put ("account", rai::account (0).to_account ());
+	request.put ("count", std::to_string (std::numeric_limits<uint64_t>::max ()));
+	test_response response1 (request, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_TRUE (response1.resp.chunked ());
+	ASSERT_EQ (1001, response1.json.get_child ("frontiers").size ());
+	request.put ("count", std::to_string (10));
+	test_response response2 (request, rpc, system.service);
+	while (response2.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response2.status);
+	ASSERT_FALSE (response2.resp.chunked ());
+	ASSERT_EQ (10, response2.json.get_child ("frontiers").size ());
+}
+
+TEST (rpc, frontier_http10)
+{
+	rai::system system (24000, 1);
+	{
+		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, true);
+		for (auto i (0); i < 1000; ++i)
+		{
+			rai::keypair key;
+			system.nodes[0]->store.account_put (transaction, key.pub, rai::account_info (key.prv.data, 0, 0, 0, 0, 0));
+		}
+	}
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::asio::ip::tcp::socket sock (system.service);
+	boost::beast::http::request<boost::beast::http::string_body> req;
+	req.method (boost::beast::http::verb::post);
+	req.target ("/");
+	req.version (10);
+	req.body () = "{\"action\": \"frontiers\", \"account\": \"" + rai::account (0).to_account () + "\", \"count\": \"1000000\"}";
+	req.prepare_payload ();
+	boost::beast::flat_buffer sb;
+	boost::beast::http::response<boost::beast::http::string_body> resp;
+	auto done (false);
+	sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		boost::beast::http::async_write (sock, req, [&](boost::system::error_code const & ec, size_t) {
+			ASSERT_FALSE (ec);
+			// Without chunked encoding the body ends when the node closes the connection
+			boost::beast::http::async_read (sock, sb, resp, [&](boost::system::error_code const & ec, size_t) {
+				ASSERT_FALSE (ec);
+				done = true;
+			});
+		});
+	});
+	while (!done)
+	{
+		system.poll ();
+	}
+	ASSERT_FALSE (resp.chunked ());
+	ASSERT_FALSE (resp.keep_alive ());
+	boost::property_tree::ptree json;
+	std::stringstream body (resp.body ());
+	boost::property_tree::read_json (body, json);
+	ASSERT_EQ (1001, json.get_child ("frontiers").size ());
+}
+
 TEST (rpc, history)
 {
 	rai::system system (24000, 1);
@@ -1314,6 +1396,8 @@ TEST (rpc_config, serialization)
 	config1.enable_control = true;
 	config1.frontier_request_limit = 8192;
 	config1.chain_request_limit = 4096;
+	config1.max_connections = 3;
+	config1.worker_threads = 2;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	rai::rpc_config config2;
@@ -1322,12 +1406,97 @@ TEST (rpc_config, serialization)
 	ASSERT_NE (config2.enable_control, config1.enable_control);
 	ASSERT_NE (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_NE (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_NE (config2.max_connections, config1.max_connections);
+	ASSERT_NE (config2.worker_threads, config1.worker_threads);
 	config2.deserialize_json (tree);
 	ASSERT_EQ (config2.address, config1.address);
 	ASSERT_EQ (config2.port, config1.port);
 	ASSERT_EQ (config2.enable_control, config1.enable_control);
 	ASSERT_EQ (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_EQ (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_EQ (config2.max_connections, config1.max_connections);
+	ASSERT_EQ (config2.worker_threads, config1.worker_threads);
+}
+
+TEST (rpc, keep_alive_pipelined)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::asio::ip::tcp::socket sock (system.service);
+	boost::beast::http::request<boost::beast::http::string_body> req;
+	req.method (boost::beast::http::verb::post);
+	req.target ("/");
+	req.version (11);
+	req.body () = "{\"action\": \"block_count\"}";
+	req.prepare_payload ();
+	std::stringstream wire;
+	wire << req << req;
+	auto text (wire.str ());
+	boost::beast::flat_buffer sb;
+	boost::beast::http::response<boost::beast::http::string_body> resp1;
+	boost::beast::http::response<boost::beast::http::string_body> resp2;
+	auto done (false);
+	sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		// Both requests are sent before either response is read
+		boost::asio::async_write (sock, boost::asio::buffer (text), [&](boost::system::error_code const & ec, size_t) {
+			ASSERT_FALSE (ec);
+			boost::beast::http::async_read (sock, sb, resp1, [&](boost::system::error_code const & ec, size_t) {
+				ASSERT_FALSE (ec);
+				boost::beast::http::async_read (sock, sb, resp2, [&](boost::system::error_code const & ec, size_t) {
+					ASSERT_FALSE (ec);
+					done = true;
+				});
+			});
+		});
+	});
+	while (!done)
+	{
+		system.poll ();
+	}
+	ASSERT_TRUE (resp1.keep_alive ());
+	ASSERT_TRUE (resp2.keep_alive ());
+	ASSERT_EQ (resp1.body (), resp2.body ());
+	ASSERT_EQ (1, rpc.connections->load ());
+}
+
+TEST (rpc, connection_outlives_rpc)
+{
+	std::shared_ptr<std::atomic<unsigned>> connections;
+	{
+		rai::system system (24000, 1);
+		boost::asio::ip::tcp::socket sock (system.service);
+		{
+			rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+			rpc.start ();
+			connections = rpc.connections;
+			sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [](boost::system::error_code const & ec) {
+				ASSERT_FALSE (ec);
+			});
+			auto iterations (0);
+			while (connections->load () == 0)
+			{
+				system.poll ();
+				++iterations;
+				ASSERT_LT (iterations, 200);
+			}
+		}
+		// The server is gone while the connection is still waiting for a request on the node's io_service
+		ASSERT_EQ (1, connections->load ());
+	}
+	// Destroying the io_service released the connection, which counted itself out without touching the server
+	ASSERT_EQ (0, connections->load ());
+}
+
+TEST (rpc, workers_started)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	// A constructed but disabled RPC server doesn't run any threads
+	ASSERT_EQ (nullptr, rpc.workers);
+	rpc.start ();
+	ASSERT_NE (nullptr, rpc.workers);
 }
 
 TEST (rpc, search_pending)
@@ -1837,6 +2006,44 @@ TEST (rpc, representatives)
 	ASSERT_EQ (rai::genesis_account, representatives[0]);
 }
 
+TEST (rpc, representatives_invalid_count)
+{
+	rai::system system0 (24000, 1);
+	rai::rpc_config config (true);
+	config.max_connections = 1;
+	rai::rpc rpc (system0.service, *system0.nodes[0], config);
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "representatives");
+	request1.put ("count", "invalid");
+	{
+		test_response response1 (request1, rpc, system0.service);
+		while (response1.status == 0)
+		{
+			system0.poll ();
+		}
+		ASSERT_EQ (200, response1.status);
+		ASSERT_EQ ("Invalid count limit", response1.json.get<std::string> ("error"));
+	}
+	// The closed connection gives its slot back
+	auto iterations (0);
+	while (rpc.connections->load () != 0)
+	{
+		system0.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	boost::property_tree::ptree request2;
+	request2.put ("action", "representatives");
+	test_response response2 (request2, rpc, system0.service);
+	while (response2.status == 0)
+	{
+		system0.poll ();
+	}
+	ASSERT_EQ (200, response2.status);
+	ASSERT_EQ (1, response2.json.get_child ("representatives").size ());
+}
+
 TEST (rpc, wallet_change_seed)
 {
 	rai::system system0 (24000, 1);
@@ -3089,3 +3296,78 @@ TEST (rpc, wallet_create_fail)
 	}
 	ASSERT_EQ ("Failed to create wallet. Increase lmdb_max_dbs in node config.", response.json.get<std::string> ("error"));
 }
+
+TEST (json_writer, ptree_compatible)
+{
+	boost::property_tree::ptree tree;
+	tree.put ("text", "quote \" slash \\ newline \n");
+	tree.put ("number", "42");
+	tree.put ("empty", "");
+	boost::property_tree::ptree list;
+	boost::property_tree::ptree entry;
+	entry.put ("", "a");
+	list.push_back (std::make_pair ("", entry));
+	list.push_back (std::make_pair ("", entry));
+	tree.add_child ("list", list);
+	tree.add_child ("none", boost::property_tree::ptree ());
+	rai::json_writer writer;
+	writer.tree (tree);
+	ASSERT_EQ ("{\"text\":\"quote \\\" slash \\\\ newline \\n\",\"number\":\"42\",\"empty\":\"\",\"list\":[\"a\",\"a\"],\"none\":\"\"}", writer.text);
+	boost::property_tree::ptree tree2;
+	std::stringstream stream (writer.text);
+	boost::property_tree::read_json (stream, tree2);
+	ASSERT_EQ (tree, tree2);
+	// An empty root is still an object, like write_json writes it
+	boost::property_tree::ptree empty;
+	rai::json_writer writer2;
+	writer2.tree (empty);
+	ASSERT_EQ ("{}", writer2.text);
+	boost::property_tree::ptree empty2;
+	std::stringstream stream2 (writer2.text);
+	boost::property_tree::read_json (stream2, empty2);
+	ASSERT_EQ (empty, empty2);
+}
+
+TEST (json_writer, streaming)
+{
+	rai::json_writer writer;
+	writer.object_begin ();
+	writer.object_begin ("blocks");
+	writer.object_end ();
+	writer.array_begin ("hashes");
+	writer.value ("1");
+	writer.value ("2");
+	writer.array_end ();
+	writer.value ("count", "2");
+	writer.object_end ();
+	ASSERT_EQ ("{\"blocks\":\"\",\"hashes\":[\"1\",\"2\"],\"count\":\"2\"}", writer.text);
+}
+
+TEST (json_reader, parse)
+{
+	std::string text ("{ \"action\" : \"accounts_balances\", \"accounts\": [\"a\", \"b\"], \"count\": -1.5e3, \"flag\": true, \"none\": null, \"escaped\": \"\\u00e9\\ud83d\\ude00\\n\", \"nested\": {\"inner\": {}} }");
+	boost::property_tree::ptree tree;
+	ASSERT_FALSE (rai::json_reader (text).parse (tree));
+	boost::property_tree::ptree tree2;
+	std::stringstream stream (text);
+	boost::property_tree::read_json (stream, tree2);
+	ASSERT_EQ (tree2, tree);
+	ASSERT_EQ ("accounts_balances", tree.get<std::string> ("action"));
+	ASSERT_EQ (2, tree.get_child ("accounts").size ());
+	ASSERT_EQ ("-1.5e3", tree.get<std::string> ("count"));
+	ASSERT_TRUE (tree.get<bool> ("flag"));
+	ASSERT_EQ ("\xc3\xa9\xf0\x9f\x98\x80\n", tree.get<std::string> ("escaped"));
+}
+
+TEST (json_reader, malformed)
+{
+	boost::property_tree::ptree tree;
+	ASSERT_TRUE (rai::json_reader ("").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("{\"action\": }").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("{\"action\": \"send\"").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("{\"action\": \"send\"} x").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("[1, 2,]").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("{\"a\": 01}").parse (tree));
+	ASSERT_TRUE (rai::json_reader ("\"\\ud83d\"").parse (tree));
+	ASSERT_TRUE (rai::json_reader (std::string (rai::json_reader::max_depth + 2, '[') + std::string (rai::json_reader::max_depth + 2, ']')).parse (tree));
+}
@@ -86,3 +86,66 @@ TEST (work, opencl_config)
 	ASSERT_EQ (2, config2.device);
 	ASSERT_EQ (3, config2.threads);
 }
+
+TEST (work, values)
+{
+	rai::uint256_union root (1);
+	ASSERT_LE (rai::work_lanes (), rai::work_lanes_max);
+	for (auto i (0); i < 100; ++i)
+	{
+		std::array<uint64_t, rai::work_lanes_max> works;
+		std::array<uint64_t, rai::work_lanes_max> outputs;
+		rai::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (works.data ()), sizeof (works));
+		rai::random_pool.GenerateBlock (root.bytes.data (), root.bytes.size ());
+		rai::work_values (root, works.data (), outputs.data ());
+		for (auto j (0); j < rai::work_lanes (); ++j)
+		{
+			ASSERT_EQ (rai::work_value (root, works[j]), outputs[j]);
+		}
+	}
+}
+
+TEST (work, value_known_answer)
+{
+	ASSERT_EQ (0xe767fad606cd5652ULL, rai::work_value (rai::uint256_union (1), 0x0123456789abcdefULL));
+	rai::uint256_union root;
+	for (auto i (0); i < root.bytes.size (); ++i)
+	{
+		root.bytes[i] = i;
+	}
+	ASSERT_EQ (0xafda7a8bcc56da65ULL, rai::work_value (root, 0));
+	// The fixed length kernel has to match the streaming blake2b hash of work || root that the network uses
+	for (auto i (0); i < 100; ++i)
+	{
+		uint64_t work;
+		rai::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (&work), sizeof (work));
+		rai::random_pool.GenerateBlock (root.bytes.data (), root.bytes.size ());
+		uint64_t expected;
+		blake2b_state hash;
+		blake2b_init (&hash, sizeof (expected));
+		blake2b_update (&hash, reinterpret_cast<uint8_t *> (&work), sizeof (work));
+		blake2b_update (&hash, root.bytes.data (), root.bytes.size ());
+		blake2b_final (&hash, reinterpret_cast<uint8_t *> (&expected), sizeof (expected));
+		ASSERT_EQ (expected, rai::work_value (root, work));
+	}
+}
+
+TEST (work, validate_batch)
+{
+	rai::work_pool pool (std::numeric_limits<unsigned>::max (), nullptr);
+	std::vector<rai::block_hash> roots;
+	std::vector<uint64_t> works;
+	for (auto i (0); i < 13; ++i)
+	{
+		rai::block_hash root (i + 1);
+		roots.push_back (root);
+		works.push_back (i % 3 == 0 ? pool.generate (root) : 0);
+	}
+	std::unique_ptr<bool[]> results (new bool[roots.size ()]);
+	rai::work_validate_batch (roots.data (), works.data (), roots.size (), results.get ());
+	for (auto i (0); i < roots.size (); ++i)
+	{
+		ASSERT_EQ (rai::work_validate (roots[i], works[i]), results[i]);
+	}
+	ASSERT_FALSE (results[0]);
+}
@@ -301,6 +301,11 @@ rai::account rai::send_block::representative () const
 	return 0;
 }
 
+rai::signature rai::send_block::block_signature () const
+{
+	return signature;
+}
+
 void rai::send_block::signature_set (rai::uint512_union const & signature_a)
 {
 	signature = signature_a;
@@ -551,6 +556,11 @@ rai::account rai::open_block::representative () const
 	return hashables.representative;
 }
 
+rai::signature rai::open_block::block_signature () const
+{
+	return signature;
+}
+
 void rai::open_block::signature_set (rai::uint512_union const & signature_a)
 {
 	signature = signature_a;
@@ -770,6 +780,11 @@ rai::account rai::change_block::representative () const
 	return hashables.representative;
 }
 
+rai::signature rai::change_block::block_signature () const
+{
+	return signature;
+}
+
 void rai::change_block::signature_set (rai::uint512_union const & signature_a)
 {
 	signature = signature_a;
@@ -824,6 +839,133 @@ std::unique_ptr<rai::block> rai::deserialize_block_json (boost::property_tree::p
 	return result;
 }
 
+rai::bufferstream::bufferstream (uint8_t const * data_a, size_t size_a)
+{
+	// The get area is never written through
+	auto data_l (const_cast<uint8_t *> (data_a));
+	setg (data_l, data_l, data_l + size_a);
+}
+
+std::streamsize rai::bufferstream::xsgetn (uint8_t * data_a, std::streamsize size_a)
+{
+	auto result (std::min<std::streamsize> (size_a, egptr () - gptr ()));
+	std::memcpy (data_a, gptr (), result);
+	gbump (static_cast<int> (result));
+	return result;
+}
+
+rai::block_view::block_view (bool & error_a, rai::block_type type_a, uint8_t const * data_a, size_t size_a) :
+type (type_a),
+data (data_a),
+size (size_a)
+{
+	auto size_l (serialized_size (type_a));
+	error_a = size_l == 0 || size_l != size_a;
+}
+
+rai::block_hash rai::block_view::hash () const
+{
+	// Hashables are serialized first and are followed by the signature and work
+	rai::block_hash result;
+	blake2b_state hash_l;
+	auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
+	assert (status == 0);
+	status = blake2b_update (&hash_l, data, size - sizeof (rai::signature) - sizeof (uint64_t));
+	assert (status == 0);
+	status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
+	assert (status == 0);
+	return result;
+}
+
+rai::block_hash rai::block_view::root () const
+{
+	rai::block_hash result;
+	// Open blocks are rooted at their account, every other type at their previous block which is serialized first
+	auto offset (type == rai::block_type::open ? sizeof (rai::block_hash) + sizeof (rai::account) : 0);
+	std::memcpy (result.bytes.data (), data + offset, sizeof (result.bytes));
+	return result;
+}
+
+uint64_t rai::block_view::work () const
+{
+	uint64_t result;
+	std::memcpy (&result, data + size - sizeof (result), sizeof (result));
+	return result;
+}
+
+std::shared_ptr<rai::block> rai::block_view::block () const
+{
+	rai::bufferstream stream (data, size);
+	auto result (rai::deserialize_block_shared (stream, type));
+	assert (result != nullptr);
+	return result;
+}
+
+size_t rai::block_view::serialized_size (rai::block_type type_a)
+{
+	size_t result (0);
+	switch (type_a)
+	{
+		case rai::block_type::send:
+			result = rai::send_block::size;
+			break;
+		case rai::block_type::receive:
+			result = rai::receive_block::size;
+			break;
+		case rai::block_type::open:
+			result = rai::open_block::size;
+			break;
+		case rai::block_type::change:
+			result = rai::change_block::size;
+			break;
+		case rai::block_type::invalid:
+		case rai::block_type::not_a_block:
+			break;
+	}
+	return result;
+}
+
+std::shared_ptr<rai::block> rai::deserialize_block_shared (rai::stream & stream_a)
+{
+	rai::block_type type;
+	auto error (read (stream_a, type));
+	std::shared_ptr<rai::block> result;
+	if (!error)
+	{
+		result = rai::deserialize_block_shared (stream_a, type);
+	}
+	return result;
+}
+
+std::shared_ptr<rai::block> rai::deserialize_block_shared (rai::stream & stream_a, rai::block_type type_a)
+{
+	std::shared_ptr<rai::block> result;
+	auto error (false);
+	switch (type_a)
+	{
+		case rai::block_type::receive:
+			result = std::allocate_shared<rai::receive_block> (rai::pool_allocator<rai::receive_block> (), error, stream_a);
+			break;
+		case rai::block_type::send:
+			result = std::allocate_shared<rai::send_block> (rai::pool_allocator<rai::send_block> (), error, stream_a);
+			break;
+		case rai::block_type::open:
+			result = std::allocate_shared<rai::open_block> (rai::pool_allocator<rai::open_block> (), error, stream_a);
+			break;
+		case rai::block_type::change:
+			result = std::allocate_shared<rai::change_block> (rai::pool_allocator<rai::change_block> (), error, stream_a);
+			break;
+		default:
+			error = true;
+			break;
+	}
+	if (error)
+	{
+		result.reset ();
+	}
+	return result;
+}
+
 std::unique_ptr<rai::block> rai::deserialize_block (rai::stream & stream_a)
 {
 	rai::block_type type;
@@ -1064,6 +1206,11 @@ rai::account rai::receive_block::representative () const
 	return 0;
 }
 
+rai::signature rai::receive_block::block_signature () const
+{
+	return signature;
+}
+
 void rai::receive_block::signature_set (rai::uint512_union const & signature_a)
 {
 	signature = signature_a;
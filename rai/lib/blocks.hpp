@@ -1,6 +1,7 @@
 #pragma once
 
 #include <rai/lib/numbers.hpp>
+#include <rai/lib/utility.hpp>
 
 #include <assert.h>
 #include <blake2/blake2.h>
@@ -28,6 +29,15 @@ void write (rai::stream & stream_a, T const & value)
 	auto amount_written (stream_a.sputn (reinterpret_cast<uint8_t const *> (&value), sizeof (value)));
 	assert (amount_written == sizeof (value));
 }
+// Reads straight out of a byte buffer, construction only sets the get pointers and reads are a bounds check and memcpy
+class bufferstream : public rai::stream
+{
+public:
+	bufferstream (uint8_t const *, size_t);
+
+protected:
+	std::streamsize xsgetn (uint8_t *, std::streamsize) override;
+};
 class block_visitor;
 enum class block_type : uint8_t
 {
@@ -59,6 +69,7 @@ public:
 	virtual void visit (rai::block_visitor &) const = 0;
 	virtual bool operator== (rai::block const &) const = 0;
 	virtual rai::block_type type () const = 0;
+	virtual rai::signature block_signature () const = 0;
 	virtual void signature_set (rai::uint512_union const &) = 0;
 	virtual ~block () = default;
 };
@@ -94,6 +105,7 @@ public:
 	bool deserialize_json (boost::property_tree::ptree const &);
 	void visit (rai::block_visitor &) const override;
 	rai::block_type type () const override;
+	rai::signature block_signature () const override;
 	void signature_set (rai::uint512_union const &) override;
 	bool operator== (rai::block const &) const override;
 	bool operator== (rai::send_block const &) const;
@@ -133,6 +145,7 @@ public:
 	bool deserialize_json (boost::property_tree::ptree const &);
 	void visit (rai::block_visitor &) const override;
 	rai::block_type type () const override;
+	rai::signature block_signature () const override;
 	void signature_set (rai::uint512_union const &) override;
 	bool operator== (rai::block const &) const override;
 	bool operator== (rai::receive_block const &) const;
@@ -174,6 +187,7 @@ public:
 	bool deserialize_json (boost::property_tree::ptree const &);
 	void visit (rai::block_visitor &) const override;
 	rai::block_type type () const override;
+	rai::signature block_signature () const override;
 	void signature_set (rai::uint512_union const &) override;
 	bool operator== (rai::block const &) const override;
 	bool operator== (rai::open_block const &) const;
@@ -213,6 +227,7 @@ public:
 	bool deserialize_json (boost::property_tree::ptree const &);
 	void visit (rai::block_visitor &) const override;
 	rai::block_type type () const override;
+	rai::signature block_signature () const override;
 	void signature_set (rai::uint512_union const &) override;
 	bool operator== (rai::block const &) const override;
 	bool operator== (rai::change_block const &) const;
@@ -230,8 +245,27 @@ public:
 	virtual void change_block (rai::change_block const &) = 0;
 	virtual ~block_visitor () = default;
 };
+// Points at a serialized block without copying it so packets can be hashed and work checked before anything is allocated
+class block_view
+{
+public:
+	// Error if the type is unknown or the size doesn't match it exactly
+	block_view (bool &, rai::block_type, uint8_t const *, size_t);
+	rai::block_hash hash () const;
+	rai::block_hash root () const;
+	uint64_t work () const;
+	std::shared_ptr<rai::block> block () const;
+	// Serialized size of a block of this type, zero for unknown types
+	static size_t serialized_size (rai::block_type);
+	rai::block_type type;
+	uint8_t const * data;
+	size_t size;
+};
 std::unique_ptr<rai::block> deserialize_block (rai::stream &);
 std::unique_ptr<rai::block> deserialize_block (rai::stream &, rai::block_type);
+// Builds the block and its reference count in one pooled allocation, used where blocks arrive from the network
+std::shared_ptr<rai::block> deserialize_block_shared (rai::stream &);
+std::shared_ptr<rai::block> deserialize_block_shared (rai::stream &, rai::block_type);
 std::unique_ptr<rai::block> deserialize_block_json (boost::property_tree::ptree const &);
 void serialize_block (rai::stream &, rai::block const &);
 }
@@ -0,0 +1,4 @@
+#include <rai/lib/utility.hpp>
+
+thread_local uint64_t rai::pool_stats::fresh (0);
+thread_local uint64_t rai::pool_stats::reused (0);
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -29,4 +31,161 @@ public:
 	std::mutex mutex;
 	std::vector<std::function<void(T...)>> observers;
 };
+// Allocations served by pool_allocator on the calling thread, fresh ones came from the heap and reused ones from a free list
+class pool_stats
+{
+public:
+	static thread_local uint64_t fresh;
+	static thread_local uint64_t reused;
+};
+class pool_entry
+{
+public:
+	rai::pool_entry * next;
+};
+// Freed allocations of one size, shared by every thread
+// Frees from any thread are pushed without a lock and an allocating thread takes the whole list at once, entries are never popped one by one so there's no ABA problem
+// Never destroyed so memory freed during shutdown still has somewhere to go
+template <size_t Size>
+class pool_shared_list
+{
+public:
+	pool_shared_list () :
+	head (nullptr),
+	count (0)
+	{
+	}
+	void push (void * data_a)
+	{
+		if (count.fetch_add (1, std::memory_order_relaxed) < count_max)
+		{
+			auto entry (static_cast<rai::pool_entry *> (data_a));
+			entry->next = head.load (std::memory_order_relaxed);
+			while (!head.compare_exchange_weak (entry->next, entry, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+		}
+		else
+		{
+			count.fetch_sub (1, std::memory_order_relaxed);
+			::operator delete (data_a);
+		}
+	}
+	rai::pool_entry * take ()
+	{
+		// Pushes racing with this can leave count a little off until the next take, it only bounds memory
+		count.store (0, std::memory_order_relaxed);
+		return head.exchange (nullptr, std::memory_order_acquire);
+	}
+	static rai::pool_shared_list<Size> & instance ()
+	{
+		static rai::pool_shared_list<Size> result;
+		return result;
+	}
+	// Bounds the memory kept cached for each size
+	static size_t constexpr count_max = 64 * 1024;
+
+private:
+	std::atomic<rai::pool_entry *> head;
+	std::atomic<size_t> count;
+};
+// Per-thread list of allocations taken from the shared list, refilled with everything freed since the last refill when it runs dry
+template <size_t Size>
+class pool_free_list
+{
+public:
+	~pool_free_list ()
+	{
+		while (head != nullptr)
+		{
+			auto next (head->next);
+			rai::pool_shared_list<Size>::instance ().push (head);
+			head = next;
+		}
+	}
+	void * allocate ()
+	{
+		if (head == nullptr)
+		{
+			head = rai::pool_shared_list<Size>::instance ().take ();
+		}
+		void * result;
+		if (head != nullptr)
+		{
+			result = head;
+			head = head->next;
+			++rai::pool_stats::reused;
+		}
+		else
+		{
+			result = ::operator new (Size);
+			++rai::pool_stats::fresh;
+		}
+		return result;
+	}
+	static rai::pool_free_list<Size> & instance ()
+	{
+		static thread_local rai::pool_free_list<Size> result;
+		return result;
+	}
+
+private:
+	static_assert (Size >= sizeof (rai::pool_entry), "Pooled allocations must fit a free list entry");
+	rai::pool_entry * head = nullptr;
+};
+// Single object allocations are recycled through a free list for objects of the same size, meant for std::allocate_shared
+// Memory freed on one thread goes back to the shared list so whichever thread allocates next can reuse it
+template <typename T>
+class pool_allocator
+{
+public:
+	using value_type = T;
+	template <typename U>
+	class rebind
+	{
+	public:
+		using other = rai::pool_allocator<U>;
+	};
+	pool_allocator () = default;
+	template <typename U>
+	pool_allocator (rai::pool_allocator<U> const &)
+	{
+	}
+	T * allocate (size_t count_a)
+	{
+		T * result;
+		if (count_a == 1)
+		{
+			result = static_cast<T *> (rai::pool_free_list<size>::instance ().allocate ());
+		}
+		else
+		{
+			result = static_cast<T *> (::operator new (count_a * sizeof (T)));
+		}
+		return result;
+	}
+	void deallocate (T * data_a, size_t count_a)
+	{
+		if (count_a == 1)
+		{
+			rai::pool_shared_list<size>::instance ().push (data_a);
+		}
+		else
+		{
+			::operator delete (data_a);
+		}
+	}
+	// Sizes are rounded so similar types share a free list
+	static size_t constexpr size = (sizeof (T) + 15) / 16 * 16;
+};
+template <typename T, typename U>
+bool operator== (rai::pool_allocator<T> const &, rai::pool_allocator<U> const &)
+{
+	return true;
+}
+template <typename T, typename U>
+bool operator!= (rai::pool_allocator<T> const &, rai::pool_allocator<U> const &)
+{
+	return false;
+}
 }
@@ -5,27 +5,309 @@
 
 #include <future>
 
-bool rai::work_validate (rai::block_hash const & root_a, uint64_t work_a)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAI_WORK_X86
+#include <immintrin.h>
+#endif
+
+namespace
 {
-	return rai::work_value (root_a, work_a) < rai::work_pool::publish_threshold;
+uint64_t const blake2b_iv[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+uint8_t const blake2b_sigma[12][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+	{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+	{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+	{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+	{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+	{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+	{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+	{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+// Parameter block for an unkeyed 8 byte digest: digest length 8, fanout 1, depth 1
+uint64_t const blake2b_param = 0x01010008ULL;
+// work || root is always 40 bytes so the whole hash is a single compression of the final block
+uint64_t const blake2b_work_length = 40;
 }
 
-bool rai::work_validate (rai::block const & block_a)
+// One blake2b compression over m[0] = work, m[1..4] = root, m[5..15] = 0 using the lane operations WORK_* defined by each kernel
+#define WORK_G(r, i, a, b, c, d)                                   \
+	a = WORK_ADD (WORK_ADD (a, b), m[blake2b_sigma[r][2 * i]]);     \
+	d = WORK_ROR32 (WORK_XOR (d, a));                               \
+	c = WORK_ADD (c, d);                                            \
+	b = WORK_ROR24 (WORK_XOR (b, c));                               \
+	a = WORK_ADD (WORK_ADD (a, b), m[blake2b_sigma[r][2 * i + 1]]); \
+	d = WORK_ROR16 (WORK_XOR (d, a));                               \
+	c = WORK_ADD (c, d);                                            \
+	b = WORK_ROR63 (WORK_XOR (b, c));
+#define WORK_ROUND(r)                       \
+	WORK_G (r, 0, v[0], v[4], v[8], v[12])  \
+	WORK_G (r, 1, v[1], v[5], v[9], v[13])  \
+	WORK_G (r, 2, v[2], v[6], v[10], v[14]) \
+	WORK_G (r, 3, v[3], v[7], v[11], v[15]) \
+	WORK_G (r, 4, v[0], v[5], v[10], v[15]) \
+	WORK_G (r, 5, v[1], v[6], v[11], v[12]) \
+	WORK_G (r, 6, v[2], v[7], v[8], v[13])  \
+	WORK_G (r, 7, v[3], v[4], v[9], v[14])
+#define WORK_COMPRESS                                        \
+	v[0] = WORK_SET1 (blake2b_iv[0] ^ blake2b_param);        \
+	for (auto i (1); i < 8; ++i)                             \
+	{                                                        \
+		v[i] = WORK_SET1 (blake2b_iv[i]);                    \
+	}                                                        \
+	for (auto i (0); i < 4; ++i)                             \
+	{                                                        \
+		v[8 + i] = WORK_SET1 (blake2b_iv[i]);                \
+	}                                                        \
+	v[12] = WORK_SET1 (blake2b_iv[4] ^ blake2b_work_length); \
+	v[13] = WORK_SET1 (blake2b_iv[5]);                       \
+	v[14] = WORK_SET1 (~blake2b_iv[6]);                      \
+	v[15] = WORK_SET1 (blake2b_iv[7]);                       \
+	WORK_ROUND (0)                                           \
+	WORK_ROUND (1)                                           \
+	WORK_ROUND (2)                                           \
+	WORK_ROUND (3)                                           \
+	WORK_ROUND (4)                                           \
+	WORK_ROUND (5)                                           \
+	WORK_ROUND (6)                                           \
+	WORK_ROUND (7)                                           \
+	WORK_ROUND (8)                                           \
+	WORK_ROUND (9)                                           \
+	WORK_ROUND (10)                                          \
+	WORK_ROUND (11)                                          \
+	auto result (WORK_XOR (WORK_XOR (v[0], v[8]), WORK_SET1 (blake2b_iv[0] ^ blake2b_param)));
+
+namespace
 {
-	return work_validate (block_a.root (), block_a.block_work ());
+#define WORK_SET1(a) (a)
+#define WORK_ADD(a, b) ((a) + (b))
+#define WORK_XOR(a, b) ((a) ^ (b))
+#define WORK_ROR32(a) (((a) >> 32) | ((a) << 32))
+#define WORK_ROR24(a) (((a) >> 24) | ((a) << 40))
+#define WORK_ROR16(a) (((a) >> 16) | ((a) << 48))
+#define WORK_ROR63(a) (((a) >> 63) | ((a) << 1))
+// Reference kernel, one work value per call
+void work_values_scalar (rai::block_hash const * const * roots_a, uint64_t const * work_a, uint64_t * output_a)
+{
+	auto & root (*roots_a[0]);
+	uint64_t m[16] = { work_a[0], root.qwords[0], root.qwords[1], root.qwords[2], root.qwords[3] };
+	uint64_t v[16];
+	WORK_COMPRESS
+	output_a[0] = result;
+}
+#undef WORK_SET1
+#undef WORK_ADD
+#undef WORK_XOR
+#undef WORK_ROR32
+#undef WORK_ROR24
+#undef WORK_ROR16
+#undef WORK_ROR63
+
+#ifdef RAI_WORK_X86
+#define WORK_SET1(a) _mm_set1_epi64x (a)
+#define WORK_ADD(a, b) _mm_add_epi64 (a, b)
+#define WORK_XOR(a, b) _mm_xor_si128 (a, b)
+#define WORK_ROR32(a) _mm_shuffle_epi32 (a, _MM_SHUFFLE (2, 3, 0, 1))
+#define WORK_ROR24(a) _mm_shuffle_epi8 (a, r24)
+#define WORK_ROR16(a) _mm_shuffle_epi8 (a, r16)
+#define WORK_ROR63(a) _mm_xor_si128 (_mm_srli_epi64 (a, 63), _mm_add_epi64 (a, a))
+// Two work values per call
+__attribute__ ((target ("sse4.1"))) void work_values_sse41 (rai::block_hash const * const * roots_a, uint64_t const * work_a, uint64_t * output_a)
+{
+	auto r16 (_mm_setr_epi8 (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+	auto r24 (_mm_setr_epi8 (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+	__m128i m[16];
+	m[0] = _mm_loadu_si128 (reinterpret_cast<__m128i const *> (work_a));
+	for (auto i (0); i < 4; ++i)
+	{
+		m[1 + i] = _mm_set_epi64x (roots_a[1]->qwords[i], roots_a[0]->qwords[i]);
+	}
+	for (auto i (5); i < 16; ++i)
+	{
+		m[i] = _mm_setzero_si128 ();
+	}
+	__m128i v[16];
+	WORK_COMPRESS
+	_mm_storeu_si128 (reinterpret_cast<__m128i *> (output_a), result);
+}
+#undef WORK_SET1
+#undef WORK_ADD
+#undef WORK_XOR
+#undef WORK_ROR32
+#undef WORK_ROR24
+#undef WORK_ROR16
+#undef WORK_ROR63
+
+#define WORK_SET1(a) _mm256_set1_epi64x (a)
+#define WORK_ADD(a, b) _mm256_add_epi64 (a, b)
+#define WORK_XOR(a, b) _mm256_xor_si256 (a, b)
+#define WORK_ROR32(a) _mm256_shuffle_epi32 (a, _MM_SHUFFLE (2, 3, 0, 1))
+#define WORK_ROR24(a) _mm256_shuffle_epi8 (a, r24)
+#define WORK_ROR16(a) _mm256_shuffle_epi8 (a, r16)
+#define WORK_ROR63(a) _mm256_xor_si256 (_mm256_srli_epi64 (a, 63), _mm256_add_epi64 (a, a))
+// Four work values per call
+__attribute__ ((target ("avx2"))) void work_values_avx2 (rai::block_hash const * const * roots_a, uint64_t const * work_a, uint64_t * output_a)
+{
+	auto r16 (_mm256_setr_epi8 (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+	auto r24 (_mm256_setr_epi8 (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+	__m256i m[16];
+	m[0] = _mm256_loadu_si256 (reinterpret_cast<__m256i const *> (work_a));
+	for (auto i (0); i < 4; ++i)
+	{
+		m[1 + i] = _mm256_set_epi64x (roots_a[3]->qwords[i], roots_a[2]->qwords[i], roots_a[1]->qwords[i], roots_a[0]->qwords[i]);
+	}
+	for (auto i (5); i < 16; ++i)
+	{
+		m[i] = _mm256_setzero_si256 ();
+	}
+	__m256i v[16];
+	WORK_COMPRESS
+	_mm256_storeu_si256 (reinterpret_cast<__m256i *> (output_a), result);
+}
+#undef WORK_SET1
+#undef WORK_ADD
+#undef WORK_XOR
+#undef WORK_ROR32
+#undef WORK_ROR24
+#undef WORK_ROR16
+#undef WORK_ROR63
+
+#define WORK_SET1(a) _mm512_set1_epi64 (a)
+#define WORK_ADD(a, b) _mm512_add_epi64 (a, b)
+#define WORK_XOR(a, b) _mm512_xor_si512 (a, b)
+#define WORK_ROR32(a) _mm512_ror_epi64 (a, 32)
+#define WORK_ROR24(a) _mm512_ror_epi64 (a, 24)
+#define WORK_ROR16(a) _mm512_ror_epi64 (a, 16)
+#define WORK_ROR63(a) _mm512_ror_epi64 (a, 63)
+// Eight work values per call
+__attribute__ ((target ("avx512f"))) void work_values_avx512 (rai::block_hash const * const * roots_a, uint64_t const * work_a, uint64_t * output_a)
+{
+	__m512i m[16];
+	m[0] = _mm512_loadu_si512 (work_a);
+	for (auto i (0); i < 4; ++i)
+	{
+		m[1 + i] = _mm512_set_epi64 (roots_a[7]->qwords[i], roots_a[6]->qwords[i], roots_a[5]->qwords[i], roots_a[4]->qwords[i], roots_a[3]->qwords[i], roots_a[2]->qwords[i], roots_a[1]->qwords[i], roots_a[0]->qwords[i]);
+	}
+	for (auto i (5); i < 16; ++i)
+	{
+		m[i] = _mm512_setzero_si512 ();
+	}
+	__m512i v[16];
+	WORK_COMPRESS
+	_mm512_storeu_si512 (output_a, result);
+}
+#undef WORK_SET1
+#undef WORK_ADD
+#undef WORK_XOR
+#undef WORK_ROR32
+#undef WORK_ROR24
+#undef WORK_ROR16
+#undef WORK_ROR63
+#endif
+
+#undef WORK_G
+#undef WORK_ROUND
+#undef WORK_COMPRESS
+
+// Picks the widest kernel the CPU supports
+class work_kernel
+{
+public:
+	work_kernel () :
+	lanes (1),
+	values (work_values_scalar)
+	{
+#ifdef RAI_WORK_X86
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx512f"))
+		{
+			lanes = 8;
+			values = work_values_avx512;
+		}
+		else if (__builtin_cpu_supports ("avx2"))
+		{
+			lanes = 4;
+			values = work_values_avx2;
+		}
+		else if (__builtin_cpu_supports ("sse4.1"))
+		{
+			lanes = 2;
+			values = work_values_sse41;
+		}
+#endif
+	}
+	unsigned lanes;
+	void (*values) (rai::block_hash const * const *, uint64_t const *, uint64_t *);
+};
+
+work_kernel const & kernel ()
+{
+	static work_kernel result;
+	return result;
+}
+}
+
+unsigned rai::work_lanes ()
+{
+	return kernel ().lanes;
+}
+
+void rai::work_values (rai::block_hash const & root_a, uint64_t const * work_a, uint64_t * output_a)
+{
+	std::array<rai::block_hash const *, rai::work_lanes_max> roots;
+	roots.fill (&root_a);
+	kernel ().values (roots.data (), work_a, output_a);
 }
 
 uint64_t rai::work_value (rai::block_hash const & root_a, uint64_t work_a)
 {
 	uint64_t result;
-	blake2b_state hash;
-	blake2b_init (&hash, sizeof (result));
-	blake2b_update (&hash, reinterpret_cast<uint8_t *> (&work_a), sizeof (work_a));
-	blake2b_update (&hash, root_a.bytes.data (), root_a.bytes.size ());
-	blake2b_final (&hash, reinterpret_cast<uint8_t *> (&result), sizeof (result));
+	auto root (&root_a);
+	work_values_scalar (&root, &work_a, &result);
 	return result;
 }
 
+void rai::work_validate_batch (rai::block_hash const * roots_a, uint64_t const * work_a, size_t size_a, bool * result_a)
+{
+	auto & kernel_l (kernel ());
+	std::array<rai::block_hash const *, rai::work_lanes_max> roots;
+	std::array<uint64_t, rai::work_lanes_max> outputs;
+	size_t i (0);
+	// Full groups go through the SIMD kernel, the remainder through the scalar one
+	for (; i + kernel_l.lanes <= size_a; i += kernel_l.lanes)
+	{
+		for (unsigned j (0); j < kernel_l.lanes; ++j)
+		{
+			roots[j] = roots_a + i + j;
+		}
+		kernel_l.values (roots.data (), work_a + i, outputs.data ());
+		for (unsigned j (0); j < kernel_l.lanes; ++j)
+		{
+			result_a[i + j] = outputs[j] < rai::work_pool::publish_threshold;
+		}
+	}
+	for (; i < size_a; ++i)
+	{
+		result_a[i] = rai::work_validate (roots_a[i], work_a[i]);
+	}
+}
+
+bool rai::work_validate (rai::block_hash const & root_a, uint64_t work_a)
+{
+	return rai::work_value (root_a, work_a) < rai::work_pool::publish_threshold;
+}
+
+bool rai::work_validate (rai::block const & block_a)
+{
+	return work_validate (block_a.root (), block_a.block_work ());
+}
+
 rai::work_pool::work_pool (unsigned max_threads_a, std::function<boost::optional<uint64_t> (rai::uint256_union const &)> opencl_a) :
 ticket (0),
 done (false),
@@ -57,10 +339,11 @@ void rai::work_pool::loop (uint64_t thread)
 	// Quick RNG for work attempts.
 	xorshift1024star rng;
 	rai::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (rng.s.data ()), rng.s.size () * sizeof (decltype (rng.s)::value_type));
+	auto lanes (rai::work_lanes ());
+	std::array<uint64_t, rai::work_lanes_max> works;
+	std::array<uint64_t, rai::work_lanes_max> outputs;
 	uint64_t work;
 	uint64_t output;
-	blake2b_state hash;
-	blake2b_init (&hash, sizeof (output));
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!done || !pending.empty ())
 	{
@@ -85,11 +368,16 @@ void rai::work_pool::loop (uint64_t thread)
 				unsigned iteration (256);
 				while (iteration && output < rai::work_pool::publish_threshold)
 				{
-					work = rng.next ();
-					blake2b_update (&hash, reinterpret_cast<uint8_t *> (&work), sizeof (work));
-					blake2b_update (&hash, current_l.first.bytes.data (), current_l.first.bytes.size ());
-					blake2b_final (&hash, reinterpret_cast<uint8_t *> (&output), sizeof (output));
-					blake2b_init (&hash, sizeof (output));
+					for (unsigned i (0); i < lanes; ++i)
+					{
+						works[i] = rng.next ();
+					}
+					rai::work_values (current_l.first, works.data (), outputs.data ());
+					for (unsigned i (0); i < lanes && output < rai::work_pool::publish_threshold; ++i)
+					{
+						work = works[i];
+						output = outputs[i];
+					}
 					iteration -= 1;
 				}
 			}
@@ -16,6 +16,14 @@ class block;
 bool work_validate (rai::block_hash const &, uint64_t);
 bool work_validate (rai::block const &);
 uint64_t work_value (rai::block_hash const &, uint64_t);
+// Validates a batch of (root, work) pairs, result[i] is true if work i is insufficient
+void work_validate_batch (rai::block_hash const *, uint64_t const *, size_t, bool *);
+// Widest number of work values computed at once by work_values
+unsigned const work_lanes_max = 8;
+// Number of work values computed at once by work_values, picked at runtime from the SIMD instructions available
+unsigned work_lanes ();
+// Computes work_value of work_lanes () consecutive work values against the same root with a fixed length blake2b kernel
+void work_values (rai::block_hash const &, uint64_t const *, uint64_t *);
 class opencl_work;
 class work_pool
 {
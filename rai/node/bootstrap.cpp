@@ -12,6 +12,10 @@ constexpr double bootstrap_minimum_termination_time = 30.0;
 constexpr unsigned bootstrap_max_new_connections = 10;
 constexpr unsigned bootstrap_peer_frontier_minimum = rai::rai_network == rai::rai_networks::rai_live_network ? 339000 : 0;
 
+size_t constexpr rai::bulk_pull_client::buffer_size;
+size_t constexpr rai::bulk_pull_server::send_buffer_size;
+size_t constexpr rai::frontier_req_server::send_buffer_size;
+
 rai::block_synchronization::block_synchronization (boost::log::sources::logger_mt & log_a) :
 log (log_a)
 {
@@ -452,7 +456,9 @@ void rai::frontier_req_client::next (MDB_txn * transaction_a)
 }
 
 rai::bulk_pull_client::bulk_pull_client (std::shared_ptr<rai::bootstrap_client> connection_a) :
-connection (connection_a)
+connection (connection_a),
+buffer (buffer_size),
+buffered (0)
 {
 	assert (!connection->attempt->mutex.try_lock ());
 	++connection->attempt->pulling;
@@ -517,117 +523,109 @@ void rai::bulk_pull_client::receive_block ()
 {
 	auto this_l (shared_from_this ());
 	connection->start_timeout ();
-	boost::asio::async_read (connection->socket, boost::asio::buffer (connection->receive_buffer.data (), 1), [this_l](boost::system::error_code const & ec, size_t size_a) {
+	connection->socket.async_read_some (boost::asio::buffer (buffer.data () + buffered, buffer.size () - buffered), [this_l](boost::system::error_code const & ec, size_t size_a) {
 		this_l->connection->stop_timeout ();
-		if (!ec)
-		{
-			this_l->received_type ();
-		}
-		else
-		{
-			BOOST_LOG (this_l->connection->node->log) << boost::str (boost::format ("Error receiving block type %1%") % ec.message ());
-		}
+		this_l->received_buffer (ec, size_a);
 	});
 }
 
-void rai::bulk_pull_client::received_type ()
+void rai::bulk_pull_client::received_buffer (boost::system::error_code const & ec, size_t size_a)
 {
-	auto this_l (shared_from_this ());
-	rai::block_type type (static_cast<rai::block_type> (connection->receive_buffer[0]));
-	switch (type)
+	if (!ec)
 	{
-		case rai::block_type::send:
-		{
-			connection->start_timeout ();
-			boost::asio::async_read (connection->socket, boost::asio::buffer (connection->receive_buffer.data () + 1, rai::send_block::size), [this_l](boost::system::error_code const & ec, size_t size_a) {
-				this_l->connection->stop_timeout ();
-				this_l->received_block (ec, size_a);
-			});
-			break;
-		}
-		case rai::block_type::receive:
-		{
-			connection->start_timeout ();
-			boost::asio::async_read (connection->socket, boost::asio::buffer (connection->receive_buffer.data () + 1, rai::receive_block::size), [this_l](boost::system::error_code const & ec, size_t size_a) {
-				this_l->connection->stop_timeout ();
-				this_l->received_block (ec, size_a);
-			});
-			break;
-		}
-		case rai::block_type::open:
-		{
-			connection->start_timeout ();
-			boost::asio::async_read (connection->socket, boost::asio::buffer (connection->receive_buffer.data () + 1, rai::open_block::size), [this_l](boost::system::error_code const & ec, size_t size_a) {
-				this_l->connection->stop_timeout ();
-				this_l->received_block (ec, size_a);
-			});
-			break;
+		buffered += size_a;
+		// Only framing happens here, blocks are parsed and hashed on the block processor thread
+		auto end (false);
+		auto error (false);
+		auto partial (false);
+		size_t position (0);
+		while (!end && !error && !partial && position < buffered)
+		{
+			rai::block_type type (static_cast<rai::block_type> (buffer[position]));
+			auto size (rai::block_view::serialized_size (type));
+			if (type == rai::block_type::not_a_block)
+			{
+				end = true;
+				++position;
+			}
+			else if (size == 0)
+			{
+				error = true;
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Unknown type received as block type: %1%") % static_cast<int> (type));
+			}
+			else if (buffered - position > size)
+			{
+				position += 1 + size;
+			}
+			else
+			{
+				partial = true;
+			}
 		}
-		case rai::block_type::change:
+		if (position != 0)
 		{
-			connection->start_timeout ();
-			boost::asio::async_read (connection->socket, boost::asio::buffer (connection->receive_buffer.data () + 1, rai::change_block::size), [this_l](boost::system::error_code const & ec, size_t size_a) {
-				this_l->connection->stop_timeout ();
-				this_l->received_block (ec, size_a);
+			auto slice (std::make_shared<std::vector<uint8_t>> (buffer.begin (), buffer.begin () + position));
+			auto this_l (shared_from_this ());
+			connection->node->block_processor.add_producer ([this_l, slice, end](std::deque<rai::block_processor_item> & blocks_a) {
+				this_l->received_blocks (*slice, end, blocks_a);
 			});
-			break;
 		}
-		case rai::block_type::not_a_block:
+		// Keep the start of a block split across reads at the front of the buffer
+		std::memmove (buffer.data (), buffer.data () + position, buffered - position);
+		buffered -= position;
+		if (!end && !error && !connection->hard_stop.load ())
 		{
-			// Avoid re-using slow peers, or peers that sent the wrong blocks.
-			if (!connection->pending_stop && expected == pull.end)
-			{
-				connection->attempt->pool_connection (connection);
-			}
-			break;
-		}
-		default:
-		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Unknown type received as block type: %1%") % static_cast<int> (type));
-			break;
+			receive_block ();
 		}
 	}
+	else
+	{
+		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Error bulk receiving block: %1%") % ec.message ());
+	}
 }
 
-void rai::bulk_pull_client::received_block (boost::system::error_code const & ec, size_t size_a)
+void rai::bulk_pull_client::received_blocks (std::vector<uint8_t> const & slice_a, bool end_a, std::deque<rai::block_processor_item> & blocks_a)
 {
-	if (!ec)
+	size_t blocks (0);
+	size_t position (0);
+	while (position < slice_a.size () && static_cast<rai::block_type> (slice_a[position]) != rai::block_type::not_a_block)
 	{
-		rai::bufferstream stream (connection->receive_buffer.data (), 1 + size_a);
-		std::shared_ptr<rai::block> block (rai::deserialize_block (stream));
-		if (block != nullptr)
+		rai::block_type type (static_cast<rai::block_type> (slice_a[position]));
+		auto size (rai::block_view::serialized_size (type));
+		bool error_l;
+		rai::block_view view (error_l, type, slice_a.data () + position + 1, size);
+		assert (!error_l);
+		auto block (view.block ());
+		auto hash (block->hash ());
+		if (connection->node->config.logging.bulk_pull_logging ())
 		{
-			auto hash (block->hash ());
-			if (connection->node->config.logging.bulk_pull_logging ())
-			{
-				std::string block_l;
-				block->serialize_json (block_l);
-				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Pulled block %1% %2%") % hash.to_string () % block_l);
-			}
-			if (hash == expected)
-			{
-				expected = block->previous ();
-			}
-			connection->attempt->node->block_processor.add (rai::block_processor_item (block));
-			if (connection->block_count++ == 0)
-			{
-				connection->start_time = std::chrono::steady_clock::now ();
-			}
-			connection->attempt->total_blocks++;
-			connection->attempt->node->block_processor.add (rai::block_processor_item (block));
-			if (!connection->hard_stop.load ())
-			{
-				receive_block ();
-			}
+			std::string block_l;
+			block->serialize_json (block_l);
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Pulled block %1% %2%") % hash.to_string () % block_l);
 		}
-		else
+		if (hash == expected)
 		{
-			BOOST_LOG (connection->node->log) << "Error deserializing block received from pull request";
+			expected = block->previous ();
 		}
+		blocks_a.push_back (rai::block_processor_item (block));
+		++blocks;
+		position += 1 + size;
 	}
-	else
+	if (blocks != 0)
 	{
-		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Error bulk receiving block: %1%") % ec.message ());
+		if (connection->block_count.fetch_add (blocks) == 0)
+		{
+			connection->start_time = std::chrono::steady_clock::now ();
+		}
+		connection->attempt->total_blocks += blocks;
+	}
+	if (end_a)
+	{
+		// Avoid re-using slow peers, or peers that sent the wrong blocks.
+		if (!connection->pending_stop && expected == pull.end)
+		{
+			connection->attempt->pool_connection (connection);
+		}
 	}
 }
 
@@ -1621,39 +1619,81 @@ void rai::bulk_pull_server::set_current_end ()
 
 void rai::bulk_pull_server::send_next ()
 {
-	std::unique_ptr<rai::block> block (get_next ());
-	if (block != nullptr)
+	send_buffer.clear ();
+	auto finished (false);
+	while (!finished && send_buffer.size () < send_buffer_size)
 	{
-		{
-			send_buffer.clear ();
-			rai::vectorstream stream (send_buffer);
-			rai::serialize_block (stream, *block);
-		}
-		auto this_l (shared_from_this ());
+		finished = get_next (send_buffer);
+	}
+	// Don't hold the read transaction while the peer drains the write, the next batch opens a new one
+	transaction.reset ();
+	auto this_l (shared_from_this ());
+	if (finished)
+	{
+		send_buffer.push_back (static_cast<uint8_t> (rai::block_type::not_a_block));
 		if (connection->node->config.logging.bulk_pull_logging ())
 		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block->hash ().to_string ());
+			BOOST_LOG (connection->node->log) << "Bulk sending finished";
 		}
 		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
-			this_l->sent_action (ec, size_a);
+			this_l->no_block_sent (ec, size_a);
 		});
 	}
 	else
 	{
-		send_finished ();
+		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
+			this_l->sent_action (ec, size_a);
+		});
+	}
+}
+
+MDB_txn * rai::bulk_pull_server::pull_transaction ()
+{
+	if (transaction == nullptr)
+	{
+		transaction.reset (new rai::transaction (connection->node->store.environment, nullptr, false));
 	}
+	return *transaction;
 }
 
 std::unique_ptr<rai::block> rai::bulk_pull_server::get_next ()
 {
 	std::unique_ptr<rai::block> result;
+	std::vector<uint8_t> buffer;
+	if (!get_next (buffer))
+	{
+		rai::bufferstream stream (buffer.data (), buffer.size ());
+		result = rai::deserialize_block (stream);
+		assert (result != nullptr);
+	}
+	return result;
+}
+
+bool rai::bulk_pull_server::get_next (std::vector<uint8_t> & buffer_a)
+{
+	auto result (true);
 	if (current != request->end)
 	{
-		rai::transaction transaction (connection->node->store.environment, nullptr, false);
-		result = connection->node->store.block_get (transaction, current);
-		if (result != nullptr)
+		rai::block_type type;
+		auto value (connection->node->store.block_get_raw (pull_transaction (), current, type));
+		if (value.mv_size != 0)
 		{
-			auto previous (result->previous ());
+			result = false;
+			auto data (reinterpret_cast<uint8_t const *> (value.mv_data));
+			auto size (rai::block_view::serialized_size (type));
+			assert (value.mv_size >= size);
+			if (connection->node->config.logging.bulk_pull_logging ())
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % current.to_string ());
+			}
+			buffer_a.push_back (static_cast<uint8_t> (type));
+			buffer_a.insert (buffer_a.end (), data, data + size);
+			// Every block type except open starts with its previous block
+			rai::block_hash previous (0);
+			if (type != rai::block_type::open)
+			{
+				std::copy (data, data + sizeof (previous.bytes), previous.bytes.begin ());
+			}
 			if (!previous.is_zero ())
 			{
 				current = previous;
@@ -1683,25 +1723,11 @@ void rai::bulk_pull_server::sent_action (boost::system::error_code const & ec, s
 	}
 }
 
-void rai::bulk_pull_server::send_finished ()
-{
-	send_buffer.clear ();
-	send_buffer.push_back (static_cast<uint8_t> (rai::block_type::not_a_block));
-	auto this_l (shared_from_this ());
-	if (connection->node->config.logging.bulk_pull_logging ())
-	{
-		BOOST_LOG (connection->node->log) << "Bulk sending finished";
-	}
-	async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), 1), [this_l](boost::system::error_code const & ec, size_t size_a) {
-		this_l->no_block_sent (ec, size_a);
-	});
-}
-
 void rai::bulk_pull_server::no_block_sent (boost::system::error_code const & ec, size_t size_a)
 {
 	if (!ec)
 	{
-		assert (size_a == 1);
+		assert (size_a == send_buffer.size ());
 		connection->finish_request ();
 	}
 	else
@@ -1973,7 +1999,7 @@ void rai::bulk_push_server::received_block (boost::system::error_code const & ec
 	if (!ec)
 	{
 		rai::bufferstream stream (receive_buffer.data (), 1 + size_a);
-		auto block (rai::deserialize_block (stream));
+		auto block (rai::deserialize_block_shared (stream));
 		if (block != nullptr)
 		{
 			if (!connection->node->bootstrap_initiator.in_progress ())
@@ -1995,38 +2021,33 @@ current (request_a->start.number () - 1),
 info (0, 0, 0, 0, 0, 0),
 request (std::move (request_a))
 {
-	next ();
-	skip_old ();
-}
-
-void rai::frontier_req_server::skip_old ()
-{
-	if (request->age != std::numeric_limits<decltype (request->age)>::max ())
-	{
-		auto now (rai::seconds_since_epoch ());
-		while (!current.is_zero () && (now - info.modified) >= request->age)
-		{
-			next ();
-		}
-	}
+	rai::transaction transaction (connection->node->store.environment, nullptr, false);
+	auto iterator (connection->node->store.latest_begin (transaction, current.number () + 1));
+	next (iterator);
 }
 
 void rai::frontier_req_server::send_next ()
 {
 	if (!current.is_zero ())
 	{
+		send_buffer.clear ();
 		{
-			send_buffer.clear ();
-			rai::vectorstream stream (send_buffer);
-			write (stream, current.bytes);
-			write (stream, info.head.bytes);
+			rai::transaction transaction (connection->node->store.environment, nullptr, false);
+			// The previous batch already read current, one cursor walks on from just past it
+			auto iterator (connection->node->store.latest_begin (transaction, current.number () + 1));
+			auto cutoff (std::chrono::steady_clock::now () + rai::transaction_timeout);
+			do
+			{
+				if (connection->node->config.logging.bulk_pull_logging ())
+				{
+					BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
+				}
+				send_buffer.insert (send_buffer.end (), current.bytes.begin (), current.bytes.end ());
+				send_buffer.insert (send_buffer.end (), info.head.bytes.begin (), info.head.bytes.end ());
+				next (iterator);
+			} while (!current.is_zero () && send_buffer.size () < send_buffer_size && std::chrono::steady_clock::now () < cutoff);
 		}
 		auto this_l (shared_from_this ());
-		if (connection->node->config.logging.bulk_pull_logging ())
-		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
-		}
-		next ();
 		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -2086,16 +2107,18 @@ void rai::frontier_req_server::sent_action (boost::system::error_code const & ec
 	}
 }
 
-void rai::frontier_req_server::next ()
+void rai::frontier_req_server::next (rai::store_iterator & iterator_a)
 {
-	rai::transaction transaction (connection->node->store.environment, nullptr, false);
-	auto iterator (connection->node->store.latest_begin (transaction, current.number () + 1));
-	if (iterator != connection->node->store.latest_end ())
+	auto found (false);
+	auto now (rai::seconds_since_epoch ());
+	auto all (request->age == std::numeric_limits<decltype (request->age)>::max ());
+	for (rai::store_iterator n (nullptr); !found && iterator_a != n; ++iterator_a)
 	{
-		current = rai::uint256_union (iterator->first.uint256 ());
-		info = rai::account_info (iterator->second);
+		current = rai::uint256_union (iterator_a->first.uint256 ());
+		info = rai::account_info (iterator_a->second);
+		found = all || (now - info.modified) < request->age;
 	}
-	else
+	if (!found)
 	{
 		current.clear ();
 	}
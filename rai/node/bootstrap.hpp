@@ -13,6 +13,7 @@
 
 namespace rai
 {
+class block_processor_item;
 class bootstrap_attempt;
 class node;
 enum class sync_result
@@ -133,12 +134,17 @@ public:
 	~bulk_pull_client ();
 	void request (rai::pull_info const &);
 	void receive_block ();
-	void received_type ();
-	void received_block (boost::system::error_code const &, size_t);
+	void received_buffer (boost::system::error_code const &, size_t);
+	// Parses a slice of whole blocks framed by received_buffer, runs on the block processor thread
+	void received_blocks (std::vector<uint8_t> const &, bool, std::deque<rai::block_processor_item> &);
 	rai::block_hash first ();
 	std::shared_ptr<rai::bootstrap_client> connection;
 	rai::block_hash expected;
 	rai::pull_info pull;
+	// Blocks are streamed into this buffer and split out in bulk, a trailing partial block is kept for the next read
+	std::vector<uint8_t> buffer;
+	size_t buffered;
+	static size_t constexpr buffer_size = 64 * 1024;
 };
 class bootstrap_client : public std::enable_shared_from_this<bootstrap_client>
 {
@@ -245,14 +251,20 @@ public:
 	bulk_pull_server (std::shared_ptr<rai::bootstrap_server> const &, std::unique_ptr<rai::bulk_pull>);
 	void set_current_end ();
 	std::unique_ptr<rai::block> get_next ();
+	// Appends the next block in wire format straight from the store, returns true once there are no more blocks
+	bool get_next (std::vector<uint8_t> &);
+	// Read transaction shared by one batch of blocks, released before the batch is written
+	MDB_txn * pull_transaction ();
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
-	void send_finished ();
 	void no_block_sent (boost::system::error_code const &, size_t);
 	std::shared_ptr<rai::bootstrap_server> connection;
 	std::unique_ptr<rai::bulk_pull> request;
 	std::vector<uint8_t> send_buffer;
 	rai::block_hash current;
+	std::unique_ptr<rai::transaction> transaction;
+	// Blocks are written to the socket once this many bytes are buffered
+	static size_t constexpr send_buffer_size = 16 * 1024;
 };
 class bulk_pull_blocks;
 class bulk_pull_blocks_server : public std::enable_shared_from_this<rai::bulk_pull_blocks_server>
@@ -289,17 +301,19 @@ class frontier_req_server : public std::enable_shared_from_this<rai::frontier_re
 {
 public:
 	frontier_req_server (std::shared_ptr<rai::bootstrap_server> const &, std::unique_ptr<rai::frontier_req>);
-	void skip_old ();
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
 	void no_block_sent (boost::system::error_code const &, size_t);
-	void next ();
+	// Move current to the next account new enough for the request, advancing the cursor past it
+	void next (rai::store_iterator &);
 	std::shared_ptr<rai::bootstrap_server> connection;
 	rai::account current;
 	rai::account_info info;
 	std::unique_ptr<rai::frontier_req> request;
 	std::vector<uint8_t> send_buffer;
 	size_t count;
+	// Frontiers are written once this many bytes are buffered or the read transaction has been open for transaction_timeout
+	static size_t constexpr send_buffer_size = 64 * 1024;
 };
 }
@@ -4,9 +4,11 @@
 #include <rai/node/wallet.hpp>
 
 std::array<uint8_t, 2> constexpr rai::message::magic_number;
+size_t constexpr rai::message::header_size;
 size_t constexpr rai::message::ipv4_only_position;
 size_t constexpr rai::message::bootstrap_server_position;
 std::bitset<16> constexpr rai::message::block_type_mask;
+size_t constexpr rai::message_filter::digest_offset;
 
 rai::message::message (rai::message_type type_a) :
 version_max (0x05),
@@ -70,17 +72,67 @@ bool rai::message::read_header (rai::stream & stream_a, uint8_t & version_max_a,
 	return result;
 }
 
-rai::message_parser::message_parser (rai::message_visitor & visitor_a, rai::work_pool & pool_a) :
+rai::message_filter::message_filter (size_t size_a) :
+hits (0),
+misses (0),
+mask (1)
+{
+	// Round up to a power of two so slots are a mask instead of a division
+	while (mask < size_a)
+	{
+		mask <<= 1;
+	}
+	digests.reset (new std::atomic<uint64_t>[mask]);
+	for (size_t i (0); i < mask; ++i)
+	{
+		digests[i].store (0, std::memory_order_relaxed);
+	}
+	mask -= 1;
+}
+
+bool rai::message_filter::apply (uint8_t const * buffer_a, size_t size_a)
+{
+	assert (size_a >= digest_offset);
+	auto digest (XXH64 (buffer_a + digest_offset, size_a - digest_offset, 0));
+	// Zero marks an empty slot
+	digest |= digest == 0;
+	auto & slot (digests[digest & mask]);
+	// A colliding message simply evicts the older digest
+	auto result (slot.exchange (digest, std::memory_order_relaxed) == digest);
+	if (result)
+	{
+		++hits;
+	}
+	else
+	{
+		++misses;
+	}
+	return result;
+}
+
+void rai::message_filter::remove (uint8_t const * buffer_a, size_t size_a)
+{
+	assert (size_a >= digest_offset);
+	uint64_t digest (XXH64 (buffer_a + digest_offset, size_a - digest_offset, 0));
+	digest |= digest == 0;
+	// Leave the slot alone if another message has evicted this one since
+	digests[digest & mask].compare_exchange_strong (digest, 0, std::memory_order_relaxed);
+}
+
+rai::message_parser::message_parser (rai::message_visitor & visitor_a, rai::work_pool & pool_a, rai::message_filter * filter_a) :
 visitor (visitor_a),
 pool (pool_a),
+filter (filter_a),
 error (false),
-insufficient_work (false)
+insufficient_work (false),
+duplicate (false)
 {
 }
 
 void rai::message_parser::deserialize_buffer (uint8_t const * buffer_a, size_t size_a)
 {
 	error = false;
+	duplicate = false;
 	rai::bufferstream header_stream (buffer_a, size_a);
 	uint8_t version_max;
 	uint8_t version_using;
@@ -89,32 +141,40 @@ void rai::message_parser::deserialize_buffer (uint8_t const * buffer_a, size_t s
 	std::bitset<16> extensions;
 	if (!rai::message::read_header (header_stream, version_max, version_using, version_min, type, extensions))
 	{
-		switch (type)
+		if (filter != nullptr && (type == rai::message_type::publish || type == rai::message_type::confirm_ack))
 		{
-			case rai::message_type::keepalive:
-			{
-				deserialize_keepalive (buffer_a, size_a);
-				break;
-			}
-			case rai::message_type::publish:
-			{
-				deserialize_publish (buffer_a, size_a);
-				break;
-			}
-			case rai::message_type::confirm_req:
-			{
-				deserialize_confirm_req (buffer_a, size_a);
-				break;
-			}
-			case rai::message_type::confirm_ack:
-			{
-				deserialize_confirm_ack (buffer_a, size_a);
-				break;
-			}
-			default:
+			// Exact re-broadcasts skip block and vote deserialization entirely
+			duplicate = filter->apply (buffer_a, size_a);
+		}
+		if (!duplicate)
+		{
+			switch (type)
 			{
-				error = true;
-				break;
+				case rai::message_type::keepalive:
+				{
+					deserialize_keepalive (buffer_a, size_a);
+					break;
+				}
+				case rai::message_type::publish:
+				{
+					deserialize_publish (buffer_a, size_a);
+					break;
+				}
+				case rai::message_type::confirm_req:
+				{
+					deserialize_confirm_req (buffer_a, size_a);
+					break;
+				}
+				case rai::message_type::confirm_ack:
+				{
+					deserialize_confirm_ack (buffer_a, size_a);
+					break;
+				}
+				default:
+				{
+					error = true;
+					break;
+				}
 			}
 		}
 	}
@@ -143,19 +203,25 @@ void rai::message_parser::deserialize_publish (uint8_t const * buffer_a, size_t
 {
 	rai::publish incoming;
 	rai::bufferstream stream (buffer_a, size_a);
-	auto error_l (incoming.deserialize (stream));
-	if (!error_l && at_end (stream))
+	auto error_l (rai::message::read_header (stream, incoming.version_max, incoming.version_using, incoming.version_min, incoming.type, incoming.extensions));
+	if (!error_l)
 	{
-		if (!rai::work_validate (*incoming.block))
-		{
-			visitor.publish (incoming);
-		}
-		else
+		// Size and work are checked on the packet bytes so only blocks worth processing are allocated
+		rai::block_view view (error_l, incoming.block_type (), buffer_a + rai::message::header_size, size_a - rai::message::header_size);
+		if (!error_l)
 		{
-			insufficient_work = true;
+			if (!rai::work_validate (view.root (), view.work ()))
+			{
+				incoming.block = view.block ();
+				visitor.publish (incoming);
+			}
+			else
+			{
+				insufficient_work = true;
+			}
 		}
 	}
-	else
+	if (error_l)
 	{
 		error = true;
 	}
@@ -165,19 +231,24 @@ void rai::message_parser::deserialize_confirm_req (uint8_t const * buffer_a, siz
 {
 	rai::confirm_req incoming;
 	rai::bufferstream stream (buffer_a, size_a);
-	auto error_l (incoming.deserialize (stream));
-	if (!error_l && at_end (stream))
+	auto error_l (rai::message::read_header (stream, incoming.version_max, incoming.version_using, incoming.version_min, incoming.type, incoming.extensions));
+	if (!error_l)
 	{
-		if (!rai::work_validate (*incoming.block))
-		{
-			visitor.confirm_req (incoming);
-		}
-		else
+		rai::block_view view (error_l, incoming.block_type (), buffer_a + rai::message::header_size, size_a - rai::message::header_size);
+		if (!error_l)
 		{
-			insufficient_work = true;
+			if (!rai::work_validate (view.root (), view.work ()))
+			{
+				incoming.block = view.block ();
+				visitor.confirm_req (incoming);
+			}
+			else
+			{
+				insufficient_work = true;
+			}
 		}
 	}
-	else
+	if (error_l)
 	{
 		error = true;
 	}
@@ -185,21 +256,39 @@ void rai::message_parser::deserialize_confirm_req (uint8_t const * buffer_a, siz
 
 void rai::message_parser::deserialize_confirm_ack (uint8_t const * buffer_a, size_t size_a)
 {
-	bool error_l;
-	rai::bufferstream stream (buffer_a, size_a);
-	rai::confirm_ack incoming (error_l, stream);
-	if (!error_l && at_end (stream))
+	rai::bufferstream header_stream (buffer_a, size_a);
+	uint8_t version_max;
+	uint8_t version_using;
+	uint8_t version_min;
+	rai::message_type type;
+	std::bitset<16> extensions;
+	auto error_l (rai::message::read_header (header_stream, version_max, version_using, version_min, type, extensions));
+	if (!error_l)
 	{
-		if (!rai::work_validate (*incoming.vote->block))
+		// Account, signature and sequence number precede the voted block
+		auto block_offset (rai::message::header_size + sizeof (rai::account) + sizeof (rai::signature) + sizeof (uint64_t));
+		error_l = size_a < block_offset;
+		if (!error_l)
 		{
-			visitor.confirm_ack (incoming);
-		}
-		else
-		{
-			insufficient_work = true;
+			auto block_type (static_cast<rai::block_type> (((extensions & rai::message::block_type_mask) >> 8).to_ullong ()));
+			rai::block_view view (error_l, block_type, buffer_a + block_offset, size_a - block_offset);
+			if (!error_l)
+			{
+				if (!rai::work_validate (view.root (), view.work ()))
+				{
+					rai::bufferstream stream (buffer_a, size_a);
+					rai::confirm_ack incoming (error_l, stream);
+					assert (!error_l);
+					visitor.confirm_ack (incoming);
+				}
+				else
+				{
+					insufficient_work = true;
+				}
+			}
 		}
 	}
-	else
+	if (error_l)
 	{
 		error = true;
 	}
@@ -279,7 +368,7 @@ bool rai::publish::deserialize (rai::stream & stream_a)
 	assert (type == rai::message_type::publish);
 	if (!result)
 	{
-		block = rai::deserialize_block (stream_a, block_type ());
+		block = rai::deserialize_block_shared (stream_a, block_type ());
 		result = block == nullptr;
 	}
 	return result;
@@ -321,7 +410,7 @@ bool rai::confirm_req::deserialize (rai::stream & stream_a)
 	assert (type == rai::message_type::confirm_req);
 	if (!result)
 	{
-		block = rai::deserialize_block (stream_a, block_type ());
+		block = rai::deserialize_block_shared (stream_a, block_type ());
 		result = block == nullptr;
 	}
 	return result;
@@ -346,7 +435,7 @@ bool rai::confirm_req::operator== (rai::confirm_req const & other_a) const
 
 rai::confirm_ack::confirm_ack (bool & error_a, rai::stream & stream_a) :
 message (error_a, stream_a),
-vote (std::make_shared<rai::vote> (error_a, stream_a, block_type ()))
+vote (std::allocate_shared<rai::vote> (rai::pool_allocator<rai::vote> (), error_a, stream_a, block_type ()))
 {
 }
 
@@ -373,7 +462,7 @@ bool rai::confirm_ack::deserialize (rai::stream & stream_a)
 				result = read (stream_a, vote->sequence);
 				if (!result)
 				{
-					vote->block = rai::deserialize_block (stream_a, block_type ());
+					vote->block = rai::deserialize_block_shared (stream_a, block_type ());
 					result = vote->block == nullptr;
 				}
 			}
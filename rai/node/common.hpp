@@ -122,15 +122,35 @@ public:
 	uint8_t version_min;
 	rai::message_type type;
 	std::bitset<16> extensions;
+	// Magic number, three version bytes, type and extensions
+	static size_t constexpr header_size = 8;
 	static size_t constexpr ipv4_only_position = 1;
 	static size_t constexpr bootstrap_server_position = 2;
 	static std::bitset<16> constexpr block_type_mask = std::bitset<16> (0x0f00);
 };
 class work_pool;
+// Remembers a 64-bit digest of recently received message bodies so exact copies relayed by many peers are handled once
+class message_filter
+{
+public:
+	message_filter (size_t);
+	// Returns true if the message was recently seen, otherwise remembers it and returns false
+	bool apply (uint8_t const *, size_t);
+	// Forgets a message that was remembered but couldn't be handled
+	void remove (uint8_t const *, size_t);
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	// Digest starts at the message type, the magic number and versions depend on the relaying peer
+	static size_t constexpr digest_offset = 5;
+
+private:
+	size_t mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> digests;
+};
 class message_parser
 {
 public:
-	message_parser (rai::message_visitor &, rai::work_pool &);
+	message_parser (rai::message_visitor &, rai::work_pool &, rai::message_filter * = nullptr);
 	void deserialize_buffer (uint8_t const *, size_t);
 	void deserialize_keepalive (uint8_t const *, size_t);
 	void deserialize_publish (uint8_t const *, size_t);
@@ -139,8 +159,11 @@ public:
 	bool at_end (rai::bufferstream &);
 	rai::message_visitor & visitor;
 	rai::work_pool & pool;
+	// Publish and confirm_ack messages already seen by this filter are dropped, null to handle everything
+	rai::message_filter * filter;
 	bool error;
 	bool insufficient_work;
+	bool duplicate;
 };
 class keepalive : public message
 {
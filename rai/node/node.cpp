@@ -31,6 +31,12 @@ std::chrono::minutes constexpr rai::node::backup_interval;
 int constexpr rai::port_mapping::mapping_timeout;
 int constexpr rai::port_mapping::check_timeout;
 unsigned constexpr rai::active_transactions::announce_interval_ms;
+size_t constexpr rai::signature_checker::batch_size;
+size_t constexpr rai::vote_processor::max_votes;
+size_t constexpr rai::network::filter_size;
+size_t constexpr rai::block_processor::unchecked_lookahead_max;
+size_t constexpr rai::block_processor::batch_queue_deep;
+std::chrono::milliseconds constexpr rai::block_processor::batch_time_min;
 
 rai::message_statistics::message_statistics () :
 keepalive (0),
@@ -40,33 +46,195 @@ confirm_ack (0)
 {
 }
 
+namespace
+{
+#ifdef SO_REUSEPORT
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+// Open and bind a socket, sharing the port with other sockets if more than one receive socket is configured
+void bind_socket (boost::asio::ip::udp::socket & socket_a, uint16_t port_a, unsigned receive_sockets_a)
+{
+	socket_a.open (boost::asio::ip::udp::v6 ());
+#ifdef SO_REUSEPORT
+	if (receive_sockets_a > 1)
+	{
+		socket_a.set_option (reuse_port (true));
+	}
+#endif
+	socket_a.bind (rai::endpoint (boost::asio::ip::address_v6::any (), port_a));
+}
+}
+
+rai::udp_receiver::udp_receiver (rai::network & network_a, boost::asio::ip::udp::socket & socket_a, std::mutex & mutex_a, size_t batch_size_a) :
+network (network_a),
+socket (socket_a),
+mutex (mutex_a),
+batch_size (batch_size_a)
+{
+	setup_batch ();
+}
+
+rai::udp_receiver::udp_receiver (rai::network & network_a, uint16_t port_a, size_t batch_size_a) :
+network (network_a),
+owned_socket (new boost::asio::ip::udp::socket (network_a.node.service)),
+socket (*owned_socket),
+mutex (owned_mutex),
+batch_size (batch_size_a)
+{
+	setup_batch ();
+	bind_socket (socket, port_a, network.node.config.receive_sockets);
+}
+
+void rai::udp_receiver::setup_batch ()
+{
+#ifdef __linux__
+	if (batch_size > 1)
+	{
+		batch_buffers.resize (batch_size);
+		batch_addresses.resize (batch_size);
+		batch_iovecs.resize (batch_size);
+		batch_headers.resize (batch_size);
+		for (size_t i (0); i < batch_size; ++i)
+		{
+			batch_iovecs[i].iov_base = batch_buffers[i].data ();
+			batch_iovecs[i].iov_len = batch_buffers[i].size ();
+			std::memset (&batch_headers[i], 0, sizeof (batch_headers[i]));
+			batch_headers[i].msg_hdr.msg_name = &batch_addresses[i];
+			batch_headers[i].msg_hdr.msg_iov = &batch_iovecs[i];
+			batch_headers[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+#endif
+}
+
+void rai::udp_receiver::receive ()
+{
+	if (network.node.config.logging.network_packet_logging ())
+	{
+		BOOST_LOG (network.node.log) << "Receiving packet";
+	}
+#ifdef __linux__
+	if (batch_size > 1)
+	{
+		receive_batch ();
+		return;
+	}
+#endif
+	std::unique_lock<std::mutex> lock (mutex);
+	socket.async_receive_from (boost::asio::buffer (buffer.data (), buffer.size ()), remote, [this](boost::system::error_code const & error, size_t size_a) {
+		receive_action (error, size_a);
+	});
+}
+
+void rai::udp_receiver::receive_action (boost::system::error_code const & error, size_t size_a)
+{
+	if (!error && network.on)
+	{
+		network.receive_packet (buffer.data (), size_a, remote);
+		receive ();
+	}
+	else
+	{
+		receive_error (error);
+	}
+}
+
+void rai::udp_receiver::receive_error (boost::system::error_code const & error)
+{
+	if (error)
+	{
+		if (network.node.config.logging.network_logging ())
+		{
+			BOOST_LOG (network.node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
+		}
+	}
+	if (network.on)
+	{
+		network.node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+	}
+}
+
+#ifdef __linux__
+void rai::udp_receiver::receive_batch ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	socket.async_receive (boost::asio::null_buffers (), [this](boost::system::error_code const & error, size_t) {
+		receive_batch_action (error);
+	});
+}
+
+void rai::udp_receiver::receive_batch_action (boost::system::error_code const & error)
+{
+	if (!error && network.on)
+	{
+		int count;
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			for (auto & header : batch_headers)
+			{
+				header.msg_hdr.msg_namelen = sizeof (sockaddr_in6);
+				header.msg_len = 0;
+			}
+			count = recvmmsg (socket.native_handle (), batch_headers.data (), batch_headers.size (), MSG_DONTWAIT, nullptr);
+		}
+		for (auto i (0); i < count; ++i)
+		{
+			rai::endpoint sender;
+			std::memcpy (sender.data (), &batch_addresses[i], batch_headers[i].msg_hdr.msg_namelen);
+			sender.resize (batch_headers[i].msg_hdr.msg_namelen);
+			network.receive_packet (batch_buffers[i].data (), batch_headers[i].msg_len, sender);
+		}
+		receive ();
+	}
+	else
+	{
+		receive_error (error);
+	}
+}
+#endif
+
+void rai::udp_receiver::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	socket.close ();
+}
+
 rai::network::network (rai::node & node_a, uint16_t port) :
-socket (node_a.service, rai::endpoint (boost::asio::ip::address_v6::any (), port)),
+socket (node_a.service),
 resolver (node_a.service),
 node (node_a),
 bad_sender_count (0),
 on (true),
 insufficient_work_count (0),
-error_count (0)
+error_count (0),
+filter (filter_size)
 {
+	auto receive_sockets (std::max<unsigned> (1, node.config.receive_sockets));
+	bind_socket (socket, port, receive_sockets);
+	receivers.push_back (std::unique_ptr<rai::udp_receiver> (new rai::udp_receiver (*this, socket, socket_mutex, node.config.receive_batch_size)));
+	// Ephemeral ports are resolved by the first bind so every other socket shares the same one
+	auto port_l (socket.local_endpoint ().port ());
+	for (unsigned i (1); i < receive_sockets; ++i)
+	{
+		receivers.push_back (std::unique_ptr<rai::udp_receiver> (new rai::udp_receiver (*this, port_l, node.config.receive_batch_size)));
+	}
 }
 
 void rai::network::receive ()
 {
-	if (node.config.logging.network_packet_logging ())
+	for (auto & i : receivers)
 	{
-		BOOST_LOG (node.log) << "Receiving packet";
+		i->receive ();
 	}
-	std::unique_lock<std::mutex> lock (socket_mutex);
-	socket.async_receive_from (boost::asio::buffer (buffer.data (), buffer.size ()), remote, [this](boost::system::error_code const & error, size_t size_a) {
-		receive_action (error, size_a);
-	});
 }
 
 void rai::network::stop ()
 {
 	on = false;
-	socket.close ();
+	for (auto & i : receivers)
+	{
+		i->stop ();
+	}
 	resolver.cancel ();
 }
 
@@ -139,6 +307,28 @@ void rai::network::republish (rai::block_hash const & hash_a, std::shared_ptr<st
 	});
 }
 
+void rai::network::republish (rai::block_hash const & hash_a, std::shared_ptr<std::vector<uint8_t>> buffer_a, std::shared_ptr<std::vector<rai::endpoint>> endpoints_a)
+{
+	outgoing.publish += endpoints_a->size ();
+	if (node.config.logging.network_publish_logging ())
+	{
+		for (auto & i : *endpoints_a)
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Publishing %1% to %2%") % hash_a.to_string () % i);
+		}
+	}
+	std::weak_ptr<rai::node> node_w (node.shared ());
+	send_buffer_many (buffer_a, endpoints_a, [node_w](boost::system::error_code const & ec, rai::endpoint const & endpoint_a) {
+		if (auto node_l = node_w.lock ())
+		{
+			if (ec && node_l->config.logging.network_logging ())
+			{
+				BOOST_LOG (node_l->log) << boost::str (boost::format ("Error sending publish: %1% to %2%") % ec.message () % endpoint_a);
+			}
+		}
+	});
+}
+
 void rai::network::rebroadcast_reps (std::shared_ptr<rai::block> block_a)
 {
 	auto hash (block_a->hash ());
@@ -149,10 +339,12 @@ void rai::network::rebroadcast_reps (std::shared_ptr<rai::block> block_a)
 		message.serialize (stream);
 	}
 	auto representatives (node.peers.representatives (2 * node.peers.size_sqrt ()));
-	for (auto i : representatives)
+	auto endpoints (std::make_shared<std::vector<rai::endpoint>> ());
+	for (auto & i : representatives)
 	{
-		republish (hash, bytes, i.endpoint);
+		endpoints->push_back (i.endpoint);
 	}
+	republish (hash, bytes, endpoints);
 }
 
 template <typename T>
@@ -170,10 +362,7 @@ bool confirm_block (MDB_txn * transaction_a, rai::node & node_a, T & list_a, std
 				rai::vectorstream stream (*bytes);
 				confirm.serialize (stream);
 			}
-			for (auto j (list_a.begin ()), m (list_a.end ()); j != m; ++j)
-			{
-				node_a.network.confirm_send (confirm, bytes, *j);
-			}
+			node_a.network.confirm_send (confirm, bytes, std::make_shared<std::vector<rai::endpoint>> (list_a.begin (), list_a.end ()));
 		});
 	}
 	return result;
@@ -203,10 +392,7 @@ void rai::network::republish_block (MDB_txn * transaction, std::shared_ptr<rai::
 			message.serialize (stream);
 		}
 		auto hash (block->hash ());
-		for (auto i (list.begin ()), n (list.end ()); i != n; ++i)
-		{
-			republish (hash, bytes, *i);
-		}
+		republish (hash, bytes, std::make_shared<std::vector<rai::endpoint>> (list));
 		if (node.config.logging.network_logging ())
 		{
 			BOOST_LOG (node.log) << boost::str (boost::format ("Block %1% was republished to peers") % hash.to_string ());
@@ -229,7 +415,8 @@ void rai::network::republish_vote (std::chrono::steady_clock::time_point const &
 {
 	if (last_vote < std::chrono::steady_clock::now () - std::chrono::seconds (1))
 	{
-		if (node.weight (vote_a->account) > rai::Mxrb_ratio * 256)
+		// The threshold is well above representation_cache_minimum so the in-memory weight is exact here
+		if (node.ledger.weight (vote_a->account) > rai::Mxrb_ratio * 256)
 		{
 			rai::confirm_ack confirm (vote_a);
 			std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
@@ -237,11 +424,7 @@ void rai::network::republish_vote (std::chrono::steady_clock::time_point const &
 				rai::vectorstream stream (*bytes);
 				confirm.serialize (stream);
 			}
-			auto list (node.peers.list_sqrt ());
-			for (auto j (list.begin ()), m (list.end ()); j != m; ++j)
-			{
-				node.network.confirm_send (confirm, bytes, *j);
-			}
+			confirm_send (confirm, bytes, std::make_shared<std::vector<rai::endpoint>> (node.peers.list_sqrt ()));
 		}
 	}
 }
@@ -249,10 +432,32 @@ void rai::network::republish_vote (std::chrono::steady_clock::time_point const &
 void rai::network::broadcast_confirm_req (std::shared_ptr<rai::block> block_a)
 {
 	auto list (node.peers.representatives (std::numeric_limits<size_t>::max ()));
-	for (auto i (list.begin ()), j (list.end ()); i != j; ++i)
+	rai::confirm_req message (block_a);
+	std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
 	{
-		node.network.send_confirm_req (i->endpoint, block_a);
+		rai::vectorstream stream (*bytes);
+		message.serialize (stream);
 	}
+	auto endpoints (std::make_shared<std::vector<rai::endpoint>> ());
+	for (auto & i : list)
+	{
+		endpoints->push_back (i.endpoint);
+		if (node.config.logging.network_message_logging ())
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Sending confirm req to %1%") % i.endpoint);
+		}
+	}
+	std::weak_ptr<rai::node> node_w (node.shared ());
+	outgoing.confirm_req += endpoints->size ();
+	send_buffer_many (bytes, endpoints, [node_w](boost::system::error_code const & ec, rai::endpoint const &) {
+		if (auto node_l = node_w.lock ())
+		{
+			if (ec && node_l->config.logging.network_logging ())
+			{
+				BOOST_LOG (node_l->log) << boost::str (boost::format ("Error sending confirm request: %1%") % ec.message ());
+			}
+		}
+	});
 	if (node.config.logging.network_logging ())
 	{
 		BOOST_LOG (node.log) << boost::str (boost::format ("Broadcasted confirm req to %1% representatives") % list.size ());
@@ -320,7 +525,8 @@ class network_message_visitor : public rai::message_visitor
 public:
 	network_message_visitor (rai::node & node_a, rai::endpoint const & sender_a) :
 	node (node_a),
-	sender (sender_a)
+	sender (sender_a),
+	vote_dropped (false)
 	{
 	}
 	virtual ~network_message_visitor () = default;
@@ -343,7 +549,10 @@ public:
 		++node.network.incoming.publish;
 		node.peers.contacted (sender, message_a.version_using);
 		node.peers.insert (sender, message_a.version_using);
-		node.process_active (message_a.block);
+		if (!node.duplicate (*message_a.block))
+		{
+			node.process_active (message_a.block);
+		}
 	}
 	void confirm_req (rai::confirm_req const & message_a) override
 	{
@@ -371,24 +580,7 @@ public:
 		node.peers.contacted (sender, message_a.version_using);
 		node.peers.insert (sender, message_a.version_using);
 		node.process_active (message_a.vote->block);
-		auto vote (node.vote_processor.vote (message_a.vote, sender));
-		if (vote.code == rai::vote_code::replay)
-		{
-			assert (vote.vote->sequence > message_a.vote->sequence);
-			// This tries to assist rep nodes that have lost track of their highest sequence number by replaying our highest known vote back to them
-			// Only do this if the sequence number is significantly different to account for network reordering
-			// Amplify attack considerations: We're sending out a confirm_ack in response to a confirm_ack for no net traffic increase
-			if (vote.vote->sequence - message_a.vote->sequence > 10000)
-			{
-				rai::confirm_ack confirm (vote.vote);
-				std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
-				{
-					rai::vectorstream stream (*bytes);
-					confirm.serialize (stream);
-				}
-				node.network.confirm_send (confirm, bytes, sender);
-			}
-		}
+		vote_dropped = node.vote_processor.add (message_a.vote, sender);
 	}
 	void bulk_pull (rai::bulk_pull const &) override
 	{
@@ -408,54 +600,43 @@ public:
 	}
 	rai::node & node;
 	rai::endpoint sender;
+	// Set when the vote processor had no room for a confirm_ack's vote
+	bool vote_dropped;
 };
 }
 
-void rai::network::receive_action (boost::system::error_code const & error, size_t size_a)
+void rai::network::receive_packet (uint8_t const * data_a, size_t size_a, rai::endpoint const & remote_a)
 {
-	if (!error && on)
+	if (!rai::reserved_address (remote_a) && remote_a != endpoint ())
 	{
-		if (!rai::reserved_address (remote) && remote != endpoint ())
+		network_message_visitor visitor (node, remote_a);
+		rai::message_parser parser (visitor, node.work, &filter);
+		parser.deserialize_buffer (data_a, size_a);
+		if (visitor.vote_dropped)
 		{
-			network_message_visitor visitor (node, remote);
-			rai::message_parser parser (visitor, node.work);
-			parser.deserialize_buffer (buffer.data (), size_a);
-			if (parser.error)
-			{
-				++error_count;
-			}
-			else if (parser.insufficient_work)
-			{
-				if (node.config.logging.insufficient_work_logging ())
-				{
-					BOOST_LOG (node.log) << "Insufficient work in message";
-				}
-				++insufficient_work_count;
-			}
+			// Let a copy from another peer through, the filter would otherwise lose this vote for good
+			filter.remove (data_a, size_a);
 		}
-		else
+		if (parser.error)
+		{
+			++error_count;
+		}
+		else if (parser.insufficient_work)
 		{
-			if (node.config.logging.network_logging ())
+			if (node.config.logging.insufficient_work_logging ())
 			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % remote.address ().to_string ());
+				BOOST_LOG (node.log) << "Insufficient work in message";
 			}
-			++bad_sender_count;
+			++insufficient_work_count;
 		}
-		receive ();
 	}
 	else
 	{
-		if (error)
-		{
-			if (node.config.logging.network_logging ())
-			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
-			}
-		}
-		if (on)
+		if (node.config.logging.network_logging ())
 		{
-			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+			BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % remote_a.address ().to_string ());
 		}
+		++bad_sender_count;
 	}
 }
 
@@ -751,7 +932,11 @@ enable_voting (true),
 bootstrap_connections (4),
 bootstrap_connections_max (64),
 callback_port (0),
-lmdb_max_dbs (128)
+lmdb_max_dbs (128),
+signature_checker_threads (std::max<unsigned> (1, std::thread::hardware_concurrency () / 2)),
+receive_sockets (1),
+receive_batch_size (1),
+block_filter_fp_rate (0.01)
 {
 	switch (rai::rai_network)
 	{
@@ -784,7 +969,7 @@ lmdb_max_dbs (128)
 
 void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) const
 {
-	tree_a.put ("version", "9");
+	tree_a.put ("version", "12");
 	tree_a.put ("peering_port", std::to_string (peering_port));
 	tree_a.put ("bootstrap_fraction_numerator", std::to_string (bootstrap_fraction_numerator));
 	tree_a.put ("receive_minimum", receive_minimum.to_string_dec ());
@@ -826,6 +1011,10 @@ void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) con
 	tree_a.put ("callback_port", std::to_string (callback_port));
 	tree_a.put ("callback_target", callback_target);
 	tree_a.put ("lmdb_max_dbs", lmdb_max_dbs);
+	tree_a.put ("signature_checker_threads", std::to_string (signature_checker_threads));
+	tree_a.put ("receive_sockets", std::to_string (receive_sockets));
+	tree_a.put ("receive_batch_size", std::to_string (receive_batch_size));
+	tree_a.put ("block_filter_fp_rate", std::to_string (block_filter_fp_rate));
 }
 
 bool rai::node_config::upgrade_json (unsigned version, boost::property_tree::ptree & tree_a)
@@ -906,6 +1095,23 @@ bool rai::node_config::upgrade_json (unsigned version, boost::property_tree::ptr
 			result = true;
 			break;
 		case 9:
+			tree_a.put ("signature_checker_threads", std::to_string (signature_checker_threads));
+			tree_a.erase ("version");
+			tree_a.put ("version", "10");
+			result = true;
+		case 10:
+			tree_a.put ("receive_sockets", std::to_string (receive_sockets));
+			tree_a.put ("receive_batch_size", std::to_string (receive_batch_size));
+			tree_a.erase ("version");
+			tree_a.put ("version", "11");
+			result = true;
+		case 11:
+			tree_a.put ("block_filter_fp_rate", std::to_string (block_filter_fp_rate));
+			tree_a.erase ("version");
+			tree_a.put ("version", "12");
+			result = true;
+			break;
+		case 12:
 			break;
 		default:
 			throw std::runtime_error ("Unknown node_config version");
@@ -978,6 +1184,10 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 		auto callback_port_l (tree_a.get<std::string> ("callback_port"));
 		callback_target = tree_a.get<std::string> ("callback_target");
 		auto lmdb_max_dbs_l = tree_a.get<std::string> ("lmdb_max_dbs");
+		auto signature_checker_threads_l (tree_a.get<std::string> ("signature_checker_threads"));
+		auto receive_sockets_l (tree_a.get<std::string> ("receive_sockets"));
+		auto receive_batch_size_l (tree_a.get<std::string> ("receive_batch_size"));
+		auto block_filter_fp_rate_l (tree_a.get<std::string> ("block_filter_fp_rate"));
 		result |= parse_port (callback_port_l, callback_port);
 		try
 		{
@@ -989,6 +1199,10 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			bootstrap_connections = std::stoul (bootstrap_connections_l);
 			bootstrap_connections_max = std::stoul (bootstrap_connections_max_l);
 			lmdb_max_dbs = std::stoi (lmdb_max_dbs_l);
+			signature_checker_threads = std::stoul (signature_checker_threads_l);
+			receive_sockets = std::stoul (receive_sockets_l);
+			receive_batch_size = std::stoul (receive_batch_size_l);
+			block_filter_fp_rate = std::stod (block_filter_fp_rate_l);
 			result |= peering_port > std::numeric_limits<uint16_t>::max ();
 			result |= logging.deserialize_json (upgraded_a, logging_l);
 			result |= receive_minimum.decode_dec (receive_minimum_l);
@@ -997,6 +1211,9 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			result |= password_fanout > 1024 * 1024;
 			result |= io_threads == 0;
 			result |= work_threads == 0;
+			result |= receive_sockets == 0;
+			result |= receive_batch_size == 0;
+			result |= !(block_filter_fp_rate > 0.0 && block_filter_fp_rate < 1.0);
 		}
 		catch (std::logic_error const &)
 		{
@@ -1019,8 +1236,138 @@ rai::account rai::node_config::random_representative ()
 }
 
 rai::vote_processor::vote_processor (rai::node & node_a) :
-node (node_a)
+dropped (0),
+node (node_a),
+stopped (false),
+active (false)
+{
+}
+
+bool rai::vote_processor::add (std::shared_ptr<rai::vote> vote_a, rai::endpoint const & endpoint_a)
+{
+	auto result (false);
+	std::lock_guard<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		if (votes.size () < max_votes)
+		{
+			votes.push_back (std::make_pair (vote_a, endpoint_a));
+			condition.notify_all ();
+		}
+		else
+		{
+			result = true;
+			// Logged every 1024 drops so a vote flood doesn't flood the log as well
+			if (dropped++ % 1024 == 0)
+			{
+				BOOST_LOG (node.log) << boost::str (boost::format ("Vote queue is full, %1% votes dropped") % dropped.load ());
+			}
+		}
+	}
+	return result;
+}
+
+void rai::vote_processor::process_loop ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!votes.empty ())
+		{
+			std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> votes_l;
+			std::swap (votes, votes_l);
+			active = true;
+			lock.unlock ();
+			verify_votes (votes_l);
+			lock.lock ();
+			active = false;
+			condition.notify_all ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+void rai::vote_processor::flush ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped && (active || !votes.empty ()))
+	{
+		condition.wait (lock);
+	}
+}
+
+void rai::vote_processor::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	condition.notify_all ();
+}
+
+void rai::vote_processor::verify_votes (std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> & votes_a)
+{
+	auto size (votes_a.size ());
+	std::vector<rai::public_key> keys;
+	std::vector<rai::uint256_union> messages;
+	std::vector<rai::signature> signatures;
+	std::vector<int> valid;
+	keys.reserve (size);
+	messages.reserve (size);
+	signatures.reserve (size);
+	for (auto & i : votes_a)
+	{
+		keys.push_back (i.first->account);
+		messages.push_back (i.first->hash ());
+		signatures.push_back (i.first->signature);
+	}
+	node.checker.verify (keys, messages, signatures, valid);
+	std::vector<rai::vote_result> results (size, rai::vote_result ({ rai::vote_code::invalid, 0 }));
+	{
+		// One read transaction checks sequence numbers for the whole batch
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		for (size_t i (0); i < size; ++i)
+		{
+			if (valid[i] == 1)
+			{
+				results[i] = node.store.vote_validate_sequence (transaction, votes_a[i].first);
+			}
+		}
+	}
+	std::vector<std::shared_ptr<rai::vote>> accepted;
+	for (size_t i (0); i < size; ++i)
+	{
+		vote_done (votes_a[i].first, votes_a[i].second, results[i]);
+		replay (votes_a[i].first, votes_a[i].second, results[i]);
+		if (results[i].code == rai::vote_code::vote)
+		{
+			accepted.push_back (votes_a[i].first);
+		}
+	}
+	// The whole batch is applied to elections under one write transaction
+	node.active.vote (accepted);
+}
+
+void rai::vote_processor::replay (std::shared_ptr<rai::vote> vote_a, rai::endpoint const & endpoint_a, rai::vote_result const & result_a)
 {
+	if (result_a.code == rai::vote_code::replay)
+	{
+		assert (result_a.vote->sequence > vote_a->sequence);
+		// This tries to assist rep nodes that have lost track of their highest sequence number by replaying our highest known vote back to them
+		// Only do this if the sequence number is significantly different to account for network reordering
+		// Amplify attack considerations: We're sending out a confirm_ack in response to a confirm_ack for no net traffic increase
+		if (result_a.vote->sequence - vote_a->sequence > 10000)
+		{
+			rai::confirm_ack confirm (result_a.vote);
+			std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+			{
+				rai::vectorstream stream (*bytes);
+				confirm.serialize (stream);
+			}
+			node.network.confirm_send (confirm, bytes, endpoint_a);
+		}
+	}
 }
 
 rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, rai::endpoint endpoint_a)
@@ -1030,10 +1377,20 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 		rai::transaction transaction (node.store.environment, nullptr, false);
 		result = node.store.vote_validate (transaction, vote_a);
 	}
+	vote_done (vote_a, endpoint_a, result);
+	if (result.code == rai::vote_code::vote)
+	{
+		node.active.vote (vote_a);
+	}
+	return result;
+}
+
+void rai::vote_processor::vote_done (std::shared_ptr<rai::vote> vote_a, rai::endpoint const & endpoint_a, rai::vote_result const & result_a)
+{
 	if (node.config.logging.vote_logging ())
 	{
 		char const * status;
-		switch (result.code)
+		switch (result_a.code)
 		{
 			case rai::vote_code::invalid:
 				status = "Invalid";
@@ -1047,7 +1404,7 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 		}
 		BOOST_LOG (node.log) << boost::str (boost::format ("Vote from: %1% sequence: %2% block: %3% status: %4%") % vote_a->account.to_account () % std::to_string (vote_a->sequence) % vote_a->block->hash ().to_string () % status);
 	}
-	switch (result.code)
+	switch (result_a.code)
 	{
 		case rai::vote_code::vote:
 			node.observers.vote (vote_a, endpoint_a);
@@ -1055,7 +1412,6 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 		case rai::vote_code::invalid:
 			break;
 	}
-	return result;
 }
 
 void rai::rep_crawler::add (rai::block_hash const & hash_a)
@@ -1083,11 +1439,108 @@ block_processor_item (block_a, false)
 
 rai::block_processor_item::block_processor_item (std::shared_ptr<rai::block> block_a, bool force_a) :
 block (block_a),
-force (force_a)
+force (force_a),
+verified (0)
+{
+}
+
+rai::signature_checker::signature_checker (unsigned threads_a) :
+stopped (false)
+{
+	for (unsigned i (0); i < threads_a; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+rai::signature_checker::~signature_checker ()
+{
+	stop ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
+}
+
+void rai::signature_checker::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	condition.notify_all ();
+}
+
+void rai::signature_checker::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!tasks.empty ())
+		{
+			auto task (tasks.front ());
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+void rai::signature_checker::verify (std::vector<rai::public_key> const & keys_a, std::vector<rai::uint256_union> const & messages_a, std::vector<rai::signature> const & signatures_a, std::vector<int> & valid_a)
 {
+	assert (keys_a.size () == messages_a.size ());
+	assert (keys_a.size () == signatures_a.size ());
+	auto size (keys_a.size ());
+	valid_a.assign (size, 0);
+	std::vector<unsigned char const *> messages (size);
+	std::vector<size_t> lengths (size, sizeof (rai::uint256_union));
+	std::vector<unsigned char const *> keys (size);
+	std::vector<unsigned char const *> signatures (size);
+	for (size_t i (0); i < size; ++i)
+	{
+		messages[i] = messages_a[i].bytes.data ();
+		keys[i] = keys_a[i].bytes.data ();
+		signatures[i] = signatures_a[i].bytes.data ();
+	}
+	size_t pending (0);
+	std::condition_variable done;
+	std::unique_lock<std::mutex> lock (mutex);
+	for (size_t i (0); i < size; i += batch_size)
+	{
+		auto count (std::min (batch_size, size - i));
+		++pending;
+		tasks.push_back ([&, i, count]() {
+			rai::validate_message_batch (messages.data () + i, lengths.data () + i, keys.data () + i, signatures.data () + i, count, valid_a.data () + i);
+			std::lock_guard<std::mutex> lock (mutex);
+			--pending;
+			done.notify_all ();
+		});
+	}
+	condition.notify_all ();
+	// Work through the queue as well so progress is made even without checker threads
+	while (pending > 0)
+	{
+		if (!tasks.empty ())
+		{
+			auto task (tasks.front ());
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			done.wait (lock);
+		}
+	}
 }
 
 rai::block_processor::block_processor (rai::node & node_a) :
+commit_latency (std::chrono::milliseconds (10)),
+bad_signatures (0),
 stopped (false),
 idle (true),
 node (node_a)
@@ -1109,7 +1562,7 @@ void rai::block_processor::stop ()
 void rai::block_processor::flush ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
-	while (!stopped && (!blocks.empty () || !idle))
+	while (!stopped && (!blocks.empty () || !producers.empty () || !writes.empty () || !idle))
 	{
 		condition.wait (lock);
 	}
@@ -1122,21 +1575,78 @@ void rai::block_processor::add (rai::block_processor_item const & item_a)
 	condition.notify_all ();
 }
 
+void rai::block_processor::add (std::deque<rai::block_processor_item> & items_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	blocks.insert (blocks.end (), items_a.begin (), items_a.end ());
+	items_a.clear ();
+	condition.notify_all ();
+}
+
+void rai::block_processor::add_producer (std::function<void(std::deque<rai::block_processor_item> &)> const & producer_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	producers.push_back (producer_a);
+	condition.notify_all ();
+}
+
+void rai::block_processor::add_write (std::function<void(MDB_txn *)> const & action_a, std::function<void()> const & committed_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		writes.push_back (std::make_pair (action_a, committed_a));
+		condition.notify_all ();
+	}
+	else
+	{
+		lock.unlock ();
+		{
+			rai::transaction transaction (node.store.environment, nullptr, true);
+			action_a (transaction);
+		}
+		if (committed_a)
+		{
+			committed_a ();
+		}
+	}
+}
+
 void rai::block_processor::process_blocks ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!stopped)
 	{
-		if (!blocks.empty ())
+		if (!blocks.empty () || !producers.empty ())
 		{
 			std::deque<rai::block_processor_item> blocks_processing;
 			std::swap (blocks, blocks_processing);
+			std::deque<std::function<void(std::deque<rai::block_processor_item> &)>> producers_l;
+			std::swap (producers, producers_l);
 			lock.unlock ();
+			for (auto & i : producers_l)
+			{
+				i (blocks_processing);
+			}
 			process_receive_many (blocks_processing);
 			// Let other threads get an opportunity to transaction lock
 			std::this_thread::yield ();
 			lock.lock ();
 		}
+		else if (!writes.empty ())
+		{
+			lock.unlock ();
+			std::deque<std::function<void()>> committed;
+			{
+				rai::transaction transaction (node.store.environment, nullptr, true);
+				process_writes (transaction, committed);
+			}
+			for (auto & i : committed)
+			{
+				i ();
+			}
+			lock.lock ();
+		}
 		else
 		{
 			idle = true;
@@ -1145,6 +1655,51 @@ void rai::block_processor::process_blocks ()
 			idle = false;
 		}
 	}
+	// Writes queued before we stopped still need to happen
+	if (!writes.empty ())
+	{
+		lock.unlock ();
+		std::deque<std::function<void()>> committed;
+		{
+			rai::transaction transaction (node.store.environment, nullptr, true);
+			process_writes (transaction, committed);
+		}
+		for (auto & i : committed)
+		{
+			i ();
+		}
+	}
+}
+
+void rai::block_processor::process_writes (MDB_txn * transaction_a, std::deque<std::function<void()>> & committed_a)
+{
+	std::deque<std::pair<std::function<void(MDB_txn *)>, std::function<void()>>> writes_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		std::swap (writes, writes_l);
+	}
+	for (auto & i : writes_l)
+	{
+		i.first (transaction_a);
+		if (i.second)
+		{
+			committed_a.push_back (i.second);
+		}
+	}
+}
+
+std::chrono::steady_clock::duration rai::block_processor::batch_time (size_t queued_a)
+{
+	// Process for around ten times the commit cost so commits stay a small fraction of write time
+	auto result (commit_latency.load () * 10);
+	if (queued_a >= batch_queue_deep)
+	{
+		// Bootstrapping, other writers piggyback on our transaction so fewer commits are worth the latency
+		result *= 4;
+	}
+	result = std::max<std::chrono::steady_clock::duration> (result, batch_time_min);
+	result = std::min<std::chrono::steady_clock::duration> (result, rai::transaction_timeout);
+	return result;
 }
 
 void rai::block_processor::process_receive_many (rai::block_processor_item const & item_a)
@@ -1156,14 +1711,26 @@ void rai::block_processor::process_receive_many (rai::block_processor_item const
 
 void rai::block_processor::process_receive_many (std::deque<rai::block_processor_item> & blocks_processing)
 {
+	// Blocks pulled out of unchecked while verifying, the write pass deletes their rows without queueing them again
+	std::unordered_set<rai::block_hash> pulled;
 	while (!blocks_processing.empty ())
 	{
+		{
+			// Signatures are checked under a read transaction so no curve math happens while writers are locked out
+			rai::transaction transaction (node.store.environment, nullptr, false);
+			verify (transaction, blocks_processing, pulled);
+		}
 		std::deque<std::pair<std::shared_ptr<rai::block>, rai::process_return>> progress;
+		std::deque<std::function<void()>> committed;
+		std::chrono::steady_clock::time_point commit_start;
 		{
 			rai::transaction transaction (node.store.environment, nullptr, true);
-			auto cutoff (std::chrono::steady_clock::now () + rai::transaction_timeout);
+			auto cutoff (std::chrono::steady_clock::now () + batch_time (blocks_processing.size ()));
+			// Blocks released from unchecked that weren't pulled in ahead, they're verified after this commit
+			std::deque<rai::block_processor_item> dependents;
 			while (!blocks_processing.empty () && std::chrono::steady_clock::now () < cutoff)
 			{
+				process_writes (transaction, committed);
 				auto item (blocks_processing.front ());
 				blocks_processing.pop_front ();
 				auto hash (item.block->hash ());
@@ -1177,7 +1744,7 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 						node.ledger.rollback (transaction, successor->hash ());
 					}
 				}
-				auto process_result (process_receive_one (transaction, item.block));
+				auto process_result (process_receive_one (transaction, item.block, item.verified));
 				switch (process_result.code)
 				{
 					case rai::process_result::progress:
@@ -1190,7 +1757,10 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 						for (auto i (cached.begin ()), n (cached.end ()); i != n; ++i)
 						{
 							node.store.unchecked_del (transaction, hash, **i);
-							blocks_processing.push_front (rai::block_processor_item (*i));
+							if (pulled.erase ((*i)->hash ()) == 0)
+							{
+								dependents.push_back (rai::block_processor_item (*i));
+							}
 						}
 						std::lock_guard<std::mutex> lock (node.gap_cache.mutex);
 						node.gap_cache.blocks.get<1> ().erase (hash);
@@ -1200,6 +1770,16 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 						break;
 				}
 			}
+			blocks_processing.insert (blocks_processing.begin (), dependents.begin (), dependents.end ());
+			process_writes (transaction, committed);
+			// Counts commit with the blocks they describe
+			node.store.block_count_put (transaction);
+			commit_start = std::chrono::steady_clock::now ();
+		}
+		commit_latency = (commit_latency.load () * 7 + (std::chrono::steady_clock::now () - commit_start)) / 8;
+		for (auto & i : committed)
+		{
+			i ();
 		}
 		for (auto & i : progress)
 		{
@@ -1216,10 +1796,110 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 	}
 }
 
-rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a)
+void rai::block_processor::verify (MDB_txn * transaction_a, std::deque<rai::block_processor_item> & items_a)
+{
+	std::unordered_set<rai::block_hash> pulled;
+	verify (transaction_a, items_a, pulled, false);
+}
+
+void rai::block_processor::verify (MDB_txn * transaction_a, std::deque<rai::block_processor_item> & items_a, std::unordered_set<rai::block_hash> & pulled_a)
+{
+	verify (transaction_a, items_a, pulled_a, true);
+}
+
+// Resolve the account that signed each block and check signatures in batches so the ledger can skip them
+// With unchecked_a set, blocks waiting in unchecked on a resolved block are pulled in to widen the batch. Their rows are left for the write pass to delete
+void rai::block_processor::verify (MDB_txn * transaction_a, std::deque<rai::block_processor_item> & items_a, std::unordered_set<rai::block_hash> & pulled_a, bool unchecked_a)
+{
+	std::unordered_map<rai::block_hash, rai::account> signers;
+	std::vector<size_t> indices;
+	std::vector<rai::public_key> keys;
+	std::vector<rai::uint256_union> hashes;
+	std::vector<rai::signature> signatures;
+	for (size_t i (0); i < items_a.size (); ++i)
+	{
+		auto block (items_a[i].block);
+		auto hash (block->hash ());
+		auto signer (items_a[i].verified);
+		// Duplicates come back as old before their signature is looked at
+		if (signer.is_zero () && !node.store.block_exists (transaction_a, hash))
+		{
+			if (block->type () == rai::block_type::open)
+			{
+				signer = static_cast<rai::open_block const &> (*block).hashables.account;
+			}
+			else
+			{
+				auto existing (signers.find (block->previous ()));
+				signer = existing != signers.end () ? existing->second : node.store.frontier_get (transaction_a, block->previous ());
+			}
+			if (!signer.is_zero ())
+			{
+				indices.push_back (i);
+				keys.push_back (signer);
+				hashes.push_back (hash);
+				signatures.push_back (block->block_signature ());
+			}
+		}
+		if (!signer.is_zero ())
+		{
+			signers[hash] = signer;
+			if (unchecked_a && items_a.size () < unchecked_lookahead_max)
+			{
+				auto cached (node.store.unchecked_get (transaction_a, hash));
+				for (auto j (cached.begin ()), n (cached.end ()); j != n; ++j)
+				{
+					if (pulled_a.insert ((*j)->hash ()).second)
+					{
+						items_a.push_back (rai::block_processor_item (*j));
+					}
+				}
+			}
+		}
+	}
+	if (!indices.empty ())
+	{
+		std::vector<int> valid;
+		node.checker.verify (keys, hashes, signatures, valid);
+		std::vector<bool> bad (items_a.size (), false);
+		size_t bad_count (0);
+		for (size_t i (0); i < indices.size (); ++i)
+		{
+			if (valid[i] == 1)
+			{
+				items_a[indices[i]].verified = keys[i];
+			}
+			else
+			{
+				bad[indices[i]] = true;
+				++bad_count;
+				if (node.config.logging.ledger_logging ())
+				{
+					BOOST_LOG (node.log) << boost::str (boost::format ("Bad signature for: %1%") % hashes[i].to_string ());
+				}
+			}
+		}
+		if (bad_count > 0)
+		{
+			bad_signatures += bad_count;
+			BOOST_LOG (node.log) << boost::str (boost::format ("Dropped %1% blocks with bad signatures, %2% in total") % bad_count % bad_signatures.load ());
+			std::deque<rai::block_processor_item> result;
+			for (size_t i (0); i < items_a.size (); ++i)
+			{
+				if (!bad[i])
+				{
+					result.push_back (items_a[i]);
+				}
+			}
+			items_a.swap (result);
+		}
+	}
+}
+
+rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a, rai::account const & verified_a)
 {
 	rai::process_return result;
-	result = node.ledger.process (transaction_a, *block_a);
+	result = node.ledger.process (transaction_a, *block_a, verified_a);
 	switch (result.code)
 	{
 		case rai::process_result::progress:
@@ -1343,7 +2023,7 @@ service (service_a),
 config (config_a),
 alarm (alarm_a),
 work (work_a),
-store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs),
+store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs, config_a.block_filter_fp_rate),
 gap_cache (*this),
 ledger (store, config_a.inactive_supply.number ()),
 active (*this),
@@ -1356,8 +2036,10 @@ application_path (application_path_a),
 port_mapping (*this),
 vote_processor (*this),
 warmed_up (0),
+checker (config.signature_checker_threads),
 block_processor (*this),
-block_processor_thread ([this]() { this->block_processor.process_blocks (); })
+block_processor_thread ([this]() { this->block_processor.process_blocks (); }),
+vote_processor_thread ([this]() { this->vote_processor.process_loop (); })
 {
 	wallets.observer = [this](bool active) {
 		observers.wallet (active);
@@ -1479,9 +2161,6 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 		this->network.send_keepalive (endpoint_a);
 		rep_query (*this, endpoint_a);
 	});
-	observers.vote.add ([this](std::shared_ptr<rai::vote> vote_a, rai::endpoint const &) {
-		active.vote (vote_a);
-	});
 	observers.vote.add ([this](std::shared_ptr<rai::vote> vote_a, rai::endpoint const &) {
 		this->gap_cache.vote (vote_a);
 	});
@@ -1574,8 +2253,8 @@ void rai::gap_cache::vote (std::shared_ptr<rai::vote> vote_a)
 	auto existing (blocks.get<1> ().find (hash));
 	if (existing != blocks.get<1> ().end ())
 	{
-		existing->votes->vote (vote_a);
-		auto winner (node.ledger.winner (transaction, *existing->votes));
+		existing->votes->vote (vote_a, node.ledger.weight (transaction, vote_a->account));
+		auto winner (existing->votes->winner ());
 		if (winner.first > bootstrap_threshold (transaction))
 		{
 			auto node_l (node.shared ());
@@ -1620,6 +2299,28 @@ void rai::gap_cache::purge_old ()
 	}
 }
 
+void rai::network::confirm_send (rai::confirm_ack const & confirm_a, std::shared_ptr<std::vector<uint8_t>> bytes_a, std::shared_ptr<std::vector<rai::endpoint>> endpoints_a)
+{
+	if (node.config.logging.network_publish_logging ())
+	{
+		for (auto & i : *endpoints_a)
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Sending confirm_ack for block %1% to %2% sequence %3%") % confirm_a.vote->block->hash ().to_string () % i % std::to_string (confirm_a.vote->sequence));
+		}
+	}
+	std::weak_ptr<rai::node> node_w (node.shared ());
+	outgoing.confirm_ack += endpoints_a->size ();
+	send_buffer_many (bytes_a, endpoints_a, [node_w](boost::system::error_code const & ec, rai::endpoint const & endpoint_a) {
+		if (auto node_l = node_w.lock ())
+		{
+			if (ec && node_l->config.logging.network_logging ())
+			{
+				BOOST_LOG (node_l->log) << boost::str (boost::format ("Error broadcasting confirm_ack to %1%: %2%") % endpoint_a % ec.message ());
+			}
+		}
+	});
+}
+
 void rai::network::confirm_send (rai::confirm_ack const & confirm_a, std::shared_ptr<std::vector<uint8_t>> bytes_a, rai::endpoint const & endpoint_a)
 {
 	if (node.config.logging.network_publish_logging ())
@@ -1639,6 +2340,32 @@ void rai::network::confirm_send (rai::confirm_ack const & confirm_a, std::shared
 	});
 }
 
+bool rai::node::duplicate (rai::block const & block_a)
+{
+	auto result (false);
+	auto hash (block_a.hash ());
+	// Most gossiped blocks are new to us or already stored, the filter answers the first case without a store lookup
+	if (store.block_filter_contains (hash))
+	{
+		rai::transaction transaction (store.environment, nullptr, false);
+		rai::block_type type;
+		auto value (store.block_get_raw (transaction, hash, type));
+		if (value.mv_size != 0)
+		{
+			// Work is the last field of every block type, stored just ahead of the successor hash
+			uint64_t existing_work;
+			assert (value.mv_size >= sizeof (existing_work) + sizeof (rai::block_hash));
+			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (value.mv_data) + value.mv_size - sizeof (rai::block_hash) - sizeof (existing_work), sizeof (existing_work));
+			auto error (rai::read (stream, existing_work));
+			assert (!error);
+			// Blocks with more work still go through the processor to replace the stored one
+			auto root (block_a.root ());
+			result = rai::work_value (root, block_a.block_work ()) <= rai::work_value (root, existing_work);
+		}
+	}
+	return result;
+}
+
 void rai::node::process_active (std::shared_ptr<rai::block> incoming)
 {
 	block_arrival.add (incoming->hash ());
@@ -1810,6 +2537,13 @@ void rai::node::stop ()
 	{
 		block_processor_thread.join ();
 	}
+	vote_processor.stop ();
+	if (vote_processor_thread.joinable ())
+	{
+		vote_processor_thread.join ();
+	}
+	// Write out what ongoing_store_flush hasn't yet, including the block counts
+	store.flush ();
 	active.stop ();
 	network.stop ();
 	bootstrap_initiator.stop ();
@@ -1883,6 +2617,10 @@ void rai::node::ongoing_keepalive ()
 	{
 		network.send_keepalive (i->endpoint);
 	}
+	if (config.logging.network_logging ())
+	{
+		BOOST_LOG (log) << boost::str (boost::format ("Duplicate message filter hits: %1% misses: %2%") % network.filter.hits.load () % network.filter.misses.load ());
+	}
 	std::weak_ptr<rai::node> node_w (shared_from_this ());
 	alarm.add (std::chrono::steady_clock::now () + period, [node_w]() {
 		if (auto node_l = node_w.lock ())
@@ -1933,11 +2671,16 @@ void rai::node::ongoing_bootstrap ()
 
 void rai::node::ongoing_store_flush ()
 {
-	{
-		rai::transaction transaction (store.environment, nullptr, true);
-		store.flush (transaction);
-	}
-	std::weak_ptr<rai::node> node_w (shared_from_this ());
+	// Shares the block processor's next commit, written votes leave vote_cache only after that commit
+	auto node_l (shared_from_this ());
+	auto written (std::make_shared<std::vector<std::shared_ptr<rai::vote>>> ());
+	block_processor.add_write ([node_l, written](MDB_txn * transaction_a) {
+		*written = node_l->store.flush (transaction_a);
+	},
+	[node_l, written]() {
+		node_l->store.flushed (*written);
+	});
+	std::weak_ptr<rai::node> node_w (node_l);
 	alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [node_w]() {
 		if (auto node_l = node_w.lock ())
 		{
@@ -2648,6 +3391,84 @@ void rai::network::send_buffer (uint8_t const * data_a, size_t size_a, rai::endp
 	});
 }
 
+// Send the same buffer to many endpoints, batching the sends into as few system calls as possible
+void rai::network::send_buffer_many (std::shared_ptr<std::vector<uint8_t>> buffer_a, std::shared_ptr<std::vector<rai::endpoint>> endpoints_a, std::function<void(boost::system::error_code const &, rai::endpoint const &)> callback_a)
+{
+	if (!endpoints_a->empty ())
+	{
+		if (node.config.logging.network_packet_logging ())
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Sending packet to %1% peers") % endpoints_a->size ());
+		}
+		std::weak_ptr<rai::node> node_w (node.shared ());
+		node.service.post ([node_w, buffer_a, endpoints_a, callback_a]() {
+			if (auto node_l = node_w.lock ())
+			{
+				node_l->network.flush_buffer_many (buffer_a, endpoints_a, callback_a);
+			}
+		});
+	}
+}
+
+void rai::network::flush_buffer_many (std::shared_ptr<std::vector<uint8_t>> buffer_a, std::shared_ptr<std::vector<rai::endpoint>> endpoints_a, std::function<void(boost::system::error_code const &, rai::endpoint const &)> callback_a)
+{
+	auto & endpoints (*endpoints_a);
+	size_t sent (0);
+#ifdef __linux__
+	iovec data;
+	data.iov_base = buffer_a->data ();
+	data.iov_len = buffer_a->size ();
+	std::vector<mmsghdr> headers (endpoints.size ());
+	for (size_t i (0); i < endpoints.size (); ++i)
+	{
+		std::memset (&headers[i], 0, sizeof (headers[i]));
+		headers[i].msg_hdr.msg_name = endpoints[i].data ();
+		headers[i].msg_hdr.msg_namelen = endpoints[i].size ();
+		headers[i].msg_hdr.msg_iov = &data;
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+	std::vector<std::pair<boost::system::error_code, size_t>> results;
+	{
+		std::lock_guard<std::mutex> lock (socket_mutex);
+		auto done (false);
+		while (!done && sent < endpoints.size ())
+		{
+			auto count (sendmmsg (socket.native_handle (), headers.data () + sent, headers.size () - sent, MSG_DONTWAIT));
+			if (count > 0)
+			{
+				for (auto i (0); i < count; ++i)
+				{
+					results.push_back (std::make_pair (boost::system::error_code (), sent + i));
+				}
+				sent += count;
+			}
+			else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				// Socket buffer is full, the rest goes through the asynchronous path
+				done = true;
+			}
+			else
+			{
+				// The first pending message failed, report it and carry on with the next one
+				results.push_back (std::make_pair (boost::system::error_code (errno, boost::system::system_category ()), sent));
+				++sent;
+			}
+		}
+	}
+	for (auto & i : results)
+	{
+		callback_a (i.first, endpoints[i.second]);
+	}
+#endif
+	for (auto i (sent); i < endpoints.size (); ++i)
+	{
+		auto endpoint (endpoints[i]);
+		send_buffer (buffer_a->data (), buffer_a->size (), endpoint, [buffer_a, endpoint, callback_a](boost::system::error_code const & ec, size_t) {
+			callback_a (ec, endpoint);
+		});
+	}
+}
+
 bool rai::peer_container::known_peer (rai::endpoint const & endpoint_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
@@ -2676,7 +3497,7 @@ void rai::election::compute_rep_votes (MDB_txn * transaction_a)
 {
 	node.wallets.foreach_representative (transaction_a, [this, transaction_a](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
 		auto vote (this->node.store.vote_generate (transaction_a, pub_a, prv_a, last_winner));
-		this->votes.vote (vote);
+		this->votes.vote (vote, this->node.ledger.weight (transaction_a, pub_a));
 	});
 }
 
@@ -2706,13 +3527,11 @@ void rai::election::confirm_once (MDB_txn * transaction_a)
 {
 	if (!confirmed.test_and_set ())
 	{
-		auto tally_l (node.ledger.tally (transaction_a, votes));
-		assert (tally_l.size () > 0);
-		auto winner (tally_l.begin ());
-		auto block_l (winner->second);
+		auto winner (votes.winner ());
+		auto block_l (winner.second);
 		if (!(*block_l == *last_winner))
 		{
-			if (winner->first > minimum_threshold (transaction_a, node.ledger))
+			if (winner.first > minimum_threshold (transaction_a, node.ledger))
 			{
 				auto node_l (node.shared ());
 				node.background ([node_l, block_l]() {
@@ -2737,9 +3556,7 @@ void rai::election::confirm_once (MDB_txn * transaction_a)
 
 bool rai::election::have_quorum (MDB_txn * transaction_a)
 {
-	auto tally_l (node.ledger.tally (transaction_a, votes));
-	assert (tally_l.size () > 0);
-	auto result (tally_l.begin ()->first > quorum_threshold (transaction_a, node.ledger));
+	auto result (votes.winner ().first > quorum_threshold (transaction_a, node.ledger));
 	return result;
 }
 
@@ -2767,18 +3584,34 @@ void rai::election::confirm_cutoff (MDB_txn * transaction_a)
 
 void rai::election::vote (std::shared_ptr<rai::vote> vote_a)
 {
-	node.network.republish_vote (last_vote, vote_a);
-	last_vote = std::chrono::steady_clock::now ();
 	rai::transaction transaction (node.store.environment, nullptr, true);
-	assert (node.store.vote_validate (transaction, vote_a).code != rai::vote_code::invalid);
-	votes.vote (vote_a);
-	confirm_if_quorum (transaction);
+	vote (transaction, std::vector<std::shared_ptr<rai::vote>> (1, vote_a));
+}
+
+void rai::election::vote (MDB_txn * transaction_a, std::vector<std::shared_ptr<rai::vote>> const & votes_a)
+{
+	for (auto & i : votes_a)
+	{
+		node.network.republish_vote (last_vote, i);
+		last_vote = std::chrono::steady_clock::now ();
+		assert (node.store.vote_validate (transaction_a, i).code != rai::vote_code::invalid);
+		// Read from the table, the in-memory weights are zero for representatives under representation_cache_minimum
+		votes.vote (i, node.ledger.weight (transaction_a, i->account));
+	}
+	confirm_if_quorum (transaction_a);
 }
 
 void rai::active_transactions::announce_votes ()
+{
+	auto node_l (node.shared ());
+	node.block_processor.add_write ([node_l](MDB_txn * transaction_a) {
+		node_l->active.announce_votes (transaction_a);
+	});
+}
+
+void rai::active_transactions::announce_votes (MDB_txn * transaction_a)
 {
 	std::vector<rai::block_hash> inactive;
-	rai::transaction transaction (node.store.environment, nullptr, true);
 	std::lock_guard<std::mutex> lock (mutex);
 
 	{
@@ -2793,7 +3626,7 @@ void rai::active_transactions::announce_votes ()
 			if (i->announcements >= contigious_announcements - 1)
 			{
 				// These blocks have reached the confirmation interval for forks
-				i->election->confirm_cutoff (transaction);
+				i->election->confirm_cutoff (transaction_a);
 				auto root_l (i->election->votes.id);
 				inactive.push_back (root_l);
 			}
@@ -2853,19 +3686,31 @@ bool rai::active_transactions::start (MDB_txn * transaction_a, std::shared_ptr<r
 // Validate a vote and apply it to the current election if one exists
 void rai::active_transactions::vote (std::shared_ptr<rai::vote> vote_a)
 {
-	std::shared_ptr<rai::election> election;
+	vote (std::vector<std::shared_ptr<rai::vote>> (1, vote_a));
+}
+
+void rai::active_transactions::vote (std::vector<std::shared_ptr<rai::vote>> const & votes_a)
+{
+	// Each election's votes stay in arrival order
+	std::map<std::shared_ptr<rai::election>, std::vector<std::shared_ptr<rai::vote>>> elections;
 	{
 		std::lock_guard<std::mutex> lock (mutex);
-		auto root (vote_a->block->root ());
-		auto existing (roots.find (root));
-		if (existing != roots.end ())
+		for (auto & i : votes_a)
 		{
-			election = existing->election;
+			auto existing (roots.find (i->block->root ()));
+			if (existing != roots.end ())
+			{
+				elections[existing->election].push_back (i);
+			}
 		}
 	}
-	if (election)
+	if (!elections.empty ())
 	{
-		election->vote (vote_a);
+		rai::transaction transaction (node.store.environment, nullptr, true);
+		for (auto & i : elections)
+		{
+			i.first->vote (transaction, i.second);
+		}
 	}
 }
 
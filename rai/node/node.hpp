@@ -43,6 +43,8 @@ class election : public std::enable_shared_from_this<rai::election>
 public:
 	election (MDB_txn *, rai::node &, std::shared_ptr<rai::block>, std::function<void(std::shared_ptr<rai::block>)> const &);
 	void vote (std::shared_ptr<rai::vote>);
+	// Apply several votes and check quorum once, all in the caller's write transaction
+	void vote (MDB_txn *, std::vector<std::shared_ptr<rai::vote>> const &);
 	// Check if we have vote quorum
 	bool have_quorum (MDB_txn *);
 	// Tell the network our view of the winner
@@ -79,9 +81,12 @@ public:
 	// Call action with confirmed block, may be different than what we started with
 	bool start (MDB_txn *, std::shared_ptr<rai::block>, std::function<void(std::shared_ptr<rai::block>)> const & = [](std::shared_ptr<rai::block>) {});
 	void vote (std::shared_ptr<rai::vote>);
+	// Apply a burst of votes, grouped by election, under one write transaction
+	void vote (std::vector<std::shared_ptr<rai::vote>> const &);
 	// Is the root of this block in the roots container
 	bool active (rai::block const &);
 	void announce_votes ();
+	void announce_votes (MDB_txn *);
 	void stop ();
 	boost::multi_index_container<
 	rai::conflict_info,
@@ -293,36 +298,72 @@ public:
 	arrival;
 	std::mutex mutex;
 };
+class network;
+// Receives datagrams from one socket into buffers of its own so several sockets bound to the same port can be serviced in parallel
+class udp_receiver
+{
+public:
+	udp_receiver (rai::network &, boost::asio::ip::udp::socket &, std::mutex &, size_t);
+	udp_receiver (rai::network &, uint16_t, size_t);
+	void receive ();
+	void receive_action (boost::system::error_code const &, size_t);
+	void receive_error (boost::system::error_code const &);
+	void setup_batch ();
+	void stop ();
+	rai::network & network;
+	std::unique_ptr<boost::asio::ip::udp::socket> owned_socket;
+	std::mutex owned_mutex;
+	boost::asio::ip::udp::socket & socket;
+	std::mutex & mutex;
+	rai::endpoint remote;
+	std::array<uint8_t, 512> buffer;
+#ifdef __linux__
+	// Drains up to batch_size datagrams per wakeup with recvmmsg
+	void receive_batch ();
+	void receive_batch_action (boost::system::error_code const &);
+	std::vector<std::array<uint8_t, 512>> batch_buffers;
+	std::vector<sockaddr_in6> batch_addresses;
+	std::vector<iovec> batch_iovecs;
+	std::vector<mmsghdr> batch_headers;
+#endif
+	size_t batch_size;
+};
 class network
 {
 public:
 	network (rai::node &, uint16_t);
 	void receive ();
 	void stop ();
-	void receive_action (boost::system::error_code const &, size_t);
+	void receive_packet (uint8_t const *, size_t, rai::endpoint const &);
 	void rpc_action (boost::system::error_code const &, size_t);
 	void rebroadcast_reps (std::shared_ptr<rai::block>);
 	void republish_vote (std::chrono::steady_clock::time_point const &, std::shared_ptr<rai::vote>);
 	void republish_block (MDB_txn *, std::shared_ptr<rai::block>);
 	void republish (rai::block_hash const &, std::shared_ptr<std::vector<uint8_t>>, rai::endpoint);
+	void republish (rai::block_hash const &, std::shared_ptr<std::vector<uint8_t>>, std::shared_ptr<std::vector<rai::endpoint>>);
 	void publish_broadcast (std::vector<rai::peer_information> &, std::unique_ptr<rai::block>);
 	void confirm_send (rai::confirm_ack const &, std::shared_ptr<std::vector<uint8_t>>, rai::endpoint const &);
+	void confirm_send (rai::confirm_ack const &, std::shared_ptr<std::vector<uint8_t>>, std::shared_ptr<std::vector<rai::endpoint>>);
 	void merge_peers (std::array<rai::endpoint, 8> const &);
 	void send_keepalive (rai::endpoint const &);
 	void broadcast_confirm_req (std::shared_ptr<rai::block>);
 	void send_confirm_req (rai::endpoint const &, std::shared_ptr<rai::block>);
 	void send_buffer (uint8_t const *, size_t, rai::endpoint const &, std::function<void(boost::system::error_code const &, size_t)>);
+	void send_buffer_many (std::shared_ptr<std::vector<uint8_t>>, std::shared_ptr<std::vector<rai::endpoint>>, std::function<void(boost::system::error_code const &, rai::endpoint const &)>);
+	void flush_buffer_many (std::shared_ptr<std::vector<uint8_t>>, std::shared_ptr<std::vector<rai::endpoint>>, std::function<void(boost::system::error_code const &, rai::endpoint const &)>);
 	rai::endpoint endpoint ();
-	rai::endpoint remote;
-	std::array<uint8_t, 512> buffer;
 	boost::asio::ip::udp::socket socket;
 	std::mutex socket_mutex;
 	boost::asio::ip::udp::resolver resolver;
 	rai::node & node;
-	uint64_t bad_sender_count;
+	std::vector<std::unique_ptr<rai::udp_receiver>> receivers;
+	std::atomic<uint64_t> bad_sender_count;
 	bool on;
-	uint64_t insufficient_work_count;
-	uint64_t error_count;
+	std::atomic<uint64_t> insufficient_work_count;
+	std::atomic<uint64_t> error_count;
+	// Drops publish and confirm_ack packets already received from another peer
+	rai::message_filter filter;
+	static size_t constexpr filter_size = 64 * 1024;
 	rai::message_statistics incoming;
 	rai::message_statistics outgoing;
 	static uint16_t const node_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7075 : 54000;
@@ -405,6 +446,10 @@ public:
 	uint16_t callback_port;
 	std::string callback_target;
 	int lmdb_max_dbs;
+	unsigned signature_checker_threads;
+	unsigned receive_sockets;
+	unsigned receive_batch_size;
+	double block_filter_fp_rate;
 	static std::chrono::seconds constexpr keepalive_period = std::chrono::seconds (60);
 	static std::chrono::seconds constexpr keepalive_cutoff = keepalive_period * 5;
 	static std::chrono::minutes constexpr wallet_backup_interval = std::chrono::minutes (5);
@@ -420,12 +465,31 @@ public:
 	rai::observer_set<> disconnect;
 	rai::observer_set<> started;
 };
+// Votes from the network are queued and their signatures checked in batches off the network threads
 class vote_processor
 {
 public:
 	vote_processor (rai::node &);
+	// Queue a vote for batched verification, returns true if it was dropped because the queue is full
+	bool add (std::shared_ptr<rai::vote>, rai::endpoint const &);
+	// Verify and apply a single vote on the calling thread
 	rai::vote_result vote (std::shared_ptr<rai::vote>, rai::endpoint);
+	void process_loop ();
+	void flush ();
+	void stop ();
+	static size_t constexpr max_votes = 64 * 1024;
+	std::atomic<uint64_t> dropped;
 	rai::node & node;
+
+private:
+	void verify_votes (std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> &);
+	void vote_done (std::shared_ptr<rai::vote>, rai::endpoint const &, rai::vote_result const &);
+	void replay (std::shared_ptr<rai::vote>, rai::endpoint const &, rai::vote_result const &);
+	bool stopped;
+	bool active;
+	std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> votes;
+	std::mutex mutex;
+	std::condition_variable condition;
 };
 // The network is crawled for representatives by ocassionally sending a unicast confirm_req for a specific block and watching to see if it's acknowledged with a vote.
 class rep_crawler
@@ -437,6 +501,25 @@ public:
 	std::mutex mutex;
 	std::unordered_set<rai::block_hash> active;
 };
+// Checks signatures in batches spread across a set of threads, the calling thread helps out while it waits
+class signature_checker
+{
+public:
+	signature_checker (unsigned);
+	~signature_checker ();
+	// Sets valid_a[i] to 1 for each signature that verifies, 0 otherwise
+	void verify (std::vector<rai::public_key> const &, std::vector<rai::uint256_union> const &, std::vector<rai::signature> const &, std::vector<int> &);
+	void stop ();
+	static size_t constexpr batch_size = 64;
+
+private:
+	void run ();
+	bool stopped;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::thread> threads;
+};
 class block_processor_item
 {
 public:
@@ -444,6 +527,8 @@ public:
 	block_processor_item (std::shared_ptr<rai::block>, bool);
 	std::shared_ptr<rai::block> block;
 	bool force;
+	// Account the signature was checked against before processing, zero if it hasn't been
+	rai::account verified;
 };
 // Processing blocks is a potentially long IO operation
 // This class isolates block insertion from other operations like servicing network operations
@@ -455,15 +540,40 @@ public:
 	void stop ();
 	void flush ();
 	void add (rai::block_processor_item const &);
+	// Queue a batch of blocks under a single lock acquisition, the deque is left empty
+	void add (std::deque<rai::block_processor_item> &);
+	// Queue an action that fills in blocks on the processing thread, so parsing and hashing stay off network threads
+	void add_producer (std::function<void(std::deque<rai::block_processor_item> &)> const &);
+	// Run an action inside the next block processing write transaction so it shares that commit, committed runs once that transaction has
+	void add_write (std::function<void(MDB_txn *)> const &, std::function<void()> const & = nullptr);
 	void process_receive_many (rai::block_processor_item const &);
 	void process_receive_many (std::deque<rai::block_processor_item> &);
-	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>);
+	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>, rai::account const & = rai::account (0));
+	void verify (MDB_txn *, std::deque<rai::block_processor_item> &);
+	// Also pulls in blocks waiting in unchecked on the ones it resolves, recording their hashes in the set
+	void verify (MDB_txn *, std::deque<rai::block_processor_item> &, std::unordered_set<rai::block_hash> &);
 	void process_blocks ();
+	// Runs queued writes, collecting their committed actions for the caller to run after its transaction closes
+	void process_writes (MDB_txn *, std::deque<std::function<void()>> &);
+	// How long a write transaction may stay open with this many blocks queued
+	std::chrono::steady_clock::duration batch_time (size_t);
+	// Maximum number of blocks pulled out of unchecked in one verification batch
+	static size_t constexpr unchecked_lookahead_max = 16384;
+	// Queue depth past which we assume a bootstrap and favor fewer, longer transactions
+	static size_t constexpr batch_queue_deep = 16384;
+	static std::chrono::milliseconds constexpr batch_time_min = std::chrono::milliseconds (10);
+	// Moving average of how long a write transaction takes to commit
+	std::atomic<std::chrono::steady_clock::duration> commit_latency;
+	// Blocks dropped before the ledger because their signature didn't verify
+	std::atomic<uint64_t> bad_signatures;
 
 private:
+	void verify (MDB_txn *, std::deque<rai::block_processor_item> &, std::unordered_set<rai::block_hash> &, bool);
 	bool stopped;
 	bool idle;
 	std::deque<rai::block_processor_item> blocks;
+	std::deque<std::function<void(std::deque<rai::block_processor_item> &)>> producers;
+	std::deque<std::pair<std::function<void(MDB_txn *)>, std::function<void()>>> writes;
 	std::mutex mutex;
 	std::condition_variable condition;
 	rai::node & node;
@@ -488,6 +598,8 @@ public:
 	int store_version ();
 	void process_confirmed (std::shared_ptr<rai::block>);
 	void process_message (rai::message &, rai::endpoint const &);
+	// True if the block is already stored with at least as much work
+	bool duplicate (rai::block const &);
 	void process_active (std::shared_ptr<rai::block>);
 	rai::process_return process (rai::block const &);
 	void keepalive_preconfigured (std::vector<std::string> const &);
@@ -527,8 +639,10 @@ public:
 	rai::vote_processor vote_processor;
 	rai::rep_crawler rep_crawler;
 	unsigned warmed_up;
+	rai::signature_checker checker;
 	rai::block_processor block_processor;
 	std::thread block_processor_thread;
+	std::thread vote_processor_thread;
 	rai::block_arrival block_arrival;
 	static double constexpr price_max = 16.0;
 	static double constexpr free_cutoff = 1024.0;
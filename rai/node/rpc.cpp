@@ -7,12 +7,538 @@
 
 #include <ed25519-donna/ed25519.h>
 
+size_t constexpr rai::json_reader::max_depth;
+size_t constexpr rai::rpc_handler::chunk_size;
+std::chrono::seconds constexpr rai::rpc_connection::read_timeout;
+std::chrono::seconds constexpr rai::rpc_connection::write_timeout;
+
+void rai::json_writer::object_begin ()
+{
+	separator ();
+	open ('{');
+}
+
+void rai::json_writer::object_begin (std::string const & key_a)
+{
+	key (key_a);
+	open ('{');
+}
+
+void rai::json_writer::object_end ()
+{
+	close ('}');
+}
+
+void rai::json_writer::array_begin ()
+{
+	separator ();
+	open ('[');
+}
+
+void rai::json_writer::array_begin (std::string const & key_a)
+{
+	key (key_a);
+	open ('[');
+}
+
+void rai::json_writer::array_end ()
+{
+	close (']');
+}
+
+void rai::json_writer::value (std::string const & value_a)
+{
+	separator ();
+	string (value_a);
+}
+
+void rai::json_writer::value (std::string const & key_a, std::string const & value_a)
+{
+	key (key_a);
+	string (value_a);
+}
+
+void rai::json_writer::tree (boost::property_tree::ptree const & tree_a)
+{
+	if (first.empty ())
+	{
+		// write_json always writes the root as an object, even when it's empty or only has unnamed children
+		object_value (tree_a);
+	}
+	else
+	{
+		separator ();
+		tree_value (tree_a);
+	}
+}
+
+void rai::json_writer::tree (std::string const & key_a, boost::property_tree::ptree const & tree_a)
+{
+	key (key_a);
+	tree_value (tree_a);
+}
+
+void rai::json_writer::key (std::string const & key_a)
+{
+	separator ();
+	string (key_a);
+	text.push_back (':');
+}
+
+void rai::json_writer::separator ()
+{
+	if (!first.empty ())
+	{
+		if (!first.back ())
+		{
+			text.push_back (',');
+		}
+		first.back () = false;
+	}
+}
+
+void rai::json_writer::open (char bracket_a)
+{
+	text.push_back (bracket_a);
+	first.push_back (true);
+}
+
+void rai::json_writer::close (char bracket_a)
+{
+	assert (!first.empty ());
+	if (first.back () && first.size () > 1)
+	{
+		// property_tree has no empty containers, they're written as empty strings except at the root
+		text.back () = '"';
+		text.push_back ('"');
+	}
+	else
+	{
+		text.push_back (bracket_a);
+	}
+	first.pop_back ();
+}
+
+void rai::json_writer::string (std::string const & string_a)
+{
+	static char const digits[] = "0123456789abcdef";
+	text.push_back ('"');
+	for (auto i (string_a.begin ()), n (string_a.end ()); i != n; ++i)
+	{
+		auto char_l (static_cast<unsigned char> (*i));
+		switch (char_l)
+		{
+			case '"':
+				text.append ("\\\"");
+				break;
+			case '\\':
+				text.append ("\\\\");
+				break;
+			case '\b':
+				text.append ("\\b");
+				break;
+			case '\f':
+				text.append ("\\f");
+				break;
+			case '\n':
+				text.append ("\\n");
+				break;
+			case '\r':
+				text.append ("\\r");
+				break;
+			case '\t':
+				text.append ("\\t");
+				break;
+			default:
+				if (char_l < 0x20)
+				{
+					text.append ("\\u00");
+					text.push_back (digits[char_l >> 4]);
+					text.push_back (digits[char_l & 0xf]);
+				}
+				else
+				{
+					text.push_back (*i);
+				}
+				break;
+		}
+	}
+	text.push_back ('"');
+}
+
+void rai::json_writer::tree_value (boost::property_tree::ptree const & tree_a)
+{
+	if (tree_a.empty ())
+	{
+		string (tree_a.data ());
+	}
+	else if (tree_a.count (std::string ()) == tree_a.size ())
+	{
+		open ('[');
+		for (auto & i : tree_a)
+		{
+			separator ();
+			tree_value (i.second);
+		}
+		close (']');
+	}
+	else
+	{
+		object_value (tree_a);
+	}
+}
+
+void rai::json_writer::object_value (boost::property_tree::ptree const & tree_a)
+{
+	open ('{');
+	for (auto & i : tree_a)
+	{
+		key (i.first);
+		tree_value (i.second);
+	}
+	close ('}');
+}
+
+rai::json_reader::json_reader (std::string const & text_a) :
+text (text_a),
+position (0)
+{
+}
+
+bool rai::json_reader::parse (boost::property_tree::ptree & tree_a)
+{
+	tree_a.clear ();
+	auto result (value (tree_a, 0));
+	if (!result)
+	{
+		whitespace ();
+		result = position != text.size ();
+	}
+	return result;
+}
+
+bool rai::json_reader::value (boost::property_tree::ptree & tree_a, size_t depth_a)
+{
+	auto result (depth_a > max_depth);
+	if (!result)
+	{
+		if (consume ('{'))
+		{
+			result = object (tree_a, depth_a);
+		}
+		else if (consume ('['))
+		{
+			result = array (tree_a, depth_a);
+		}
+		else if (position < text.size ())
+		{
+			switch (text[position])
+			{
+				case '"':
+					result = string (tree_a.data ());
+					break;
+				case 't':
+					result = literal ("true", tree_a.data ());
+					break;
+				case 'f':
+					result = literal ("false", tree_a.data ());
+					break;
+				case 'n':
+					result = literal ("null", tree_a.data ());
+					break;
+				default:
+					result = number (tree_a.data ());
+					break;
+			}
+		}
+		else
+		{
+			result = true;
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::object (boost::property_tree::ptree & tree_a, size_t depth_a)
+{
+	auto result (false);
+	auto done (consume ('}'));
+	while (!result && !done)
+	{
+		std::string key;
+		whitespace ();
+		result = string (key) || !consume (':');
+		if (!result)
+		{
+			auto & child (tree_a.push_back (boost::property_tree::ptree::value_type (key, boost::property_tree::ptree ()))->second);
+			result = value (child, depth_a + 1);
+			if (!result)
+			{
+				done = consume ('}');
+				result = !done && !consume (',');
+			}
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::array (boost::property_tree::ptree & tree_a, size_t depth_a)
+{
+	auto result (false);
+	auto done (consume (']'));
+	while (!result && !done)
+	{
+		auto & child (tree_a.push_back (boost::property_tree::ptree::value_type (std::string (), boost::property_tree::ptree ()))->second);
+		result = value (child, depth_a + 1);
+		if (!result)
+		{
+			done = consume (']');
+			result = !done && !consume (',');
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::string (std::string & string_a)
+{
+	auto result (position >= text.size () || text[position] != '"');
+	if (!result)
+	{
+		++position;
+		auto done (false);
+		while (!result && !done)
+		{
+			auto start (position);
+			while (position < text.size () && text[position] != '"' && text[position] != '\\' && static_cast<unsigned char> (text[position]) >= 0x20)
+			{
+				++position;
+			}
+			string_a.append (text, start, position - start);
+			if (position < text.size ())
+			{
+				switch (text[position++])
+				{
+					case '"':
+						done = true;
+						break;
+					case '\\':
+						result = escape (string_a);
+						break;
+					default:
+						// Unescaped control character
+						result = true;
+						break;
+				}
+			}
+			else
+			{
+				result = true;
+			}
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::escape (std::string & string_a)
+{
+	auto result (position >= text.size ());
+	if (!result)
+	{
+		switch (text[position++])
+		{
+			case '"':
+				string_a.push_back ('"');
+				break;
+			case '\\':
+				string_a.push_back ('\\');
+				break;
+			case '/':
+				string_a.push_back ('/');
+				break;
+			case 'b':
+				string_a.push_back ('\b');
+				break;
+			case 'f':
+				string_a.push_back ('\f');
+				break;
+			case 'n':
+				string_a.push_back ('\n');
+				break;
+			case 'r':
+				string_a.push_back ('\r');
+				break;
+			case 't':
+				string_a.push_back ('\t');
+				break;
+			case 'u':
+			{
+				unsigned code;
+				result = hex (code);
+				if (!result && code >= 0xd800 && code < 0xdc00)
+				{
+					// High surrogate, the low half must follow
+					unsigned low;
+					result = text.compare (position, 2, "\\u") != 0;
+					if (!result)
+					{
+						position += 2;
+						result = hex (low) || low < 0xdc00 || low >= 0xe000;
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					}
+				}
+				if (!result)
+				{
+					// Stored as UTF-8
+					if (code < 0x80)
+					{
+						string_a.push_back (static_cast<char> (code));
+					}
+					else if (code < 0x800)
+					{
+						string_a.push_back (static_cast<char> (0xc0 | (code >> 6)));
+						string_a.push_back (static_cast<char> (0x80 | (code & 0x3f)));
+					}
+					else if (code < 0x10000)
+					{
+						string_a.push_back (static_cast<char> (0xe0 | (code >> 12)));
+						string_a.push_back (static_cast<char> (0x80 | ((code >> 6) & 0x3f)));
+						string_a.push_back (static_cast<char> (0x80 | (code & 0x3f)));
+					}
+					else
+					{
+						string_a.push_back (static_cast<char> (0xf0 | (code >> 18)));
+						string_a.push_back (static_cast<char> (0x80 | ((code >> 12) & 0x3f)));
+						string_a.push_back (static_cast<char> (0x80 | ((code >> 6) & 0x3f)));
+						string_a.push_back (static_cast<char> (0x80 | (code & 0x3f)));
+					}
+				}
+				break;
+			}
+			default:
+				result = true;
+				break;
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::hex (unsigned & code_a)
+{
+	auto result (position + 4 > text.size ());
+	code_a = 0;
+	for (auto i (0); !result && i < 4; ++i)
+	{
+		auto char_l (text[position++]);
+		code_a <<= 4;
+		if (char_l >= '0' && char_l <= '9')
+		{
+			code_a |= char_l - '0';
+		}
+		else if (char_l >= 'a' && char_l <= 'f')
+		{
+			code_a |= char_l - 'a' + 10;
+		}
+		else if (char_l >= 'A' && char_l <= 'F')
+		{
+			code_a |= char_l - 'A' + 10;
+		}
+		else
+		{
+			result = true;
+		}
+	}
+	return result;
+}
+
+bool rai::json_reader::number (std::string & number_a)
+{
+	auto start (position);
+	if (position < text.size () && text[position] == '-')
+	{
+		++position;
+	}
+	auto result (position >= text.size ());
+	if (!result)
+	{
+		if (text[position] == '0')
+		{
+			++position;
+		}
+		else
+		{
+			result = digits () == 0;
+		}
+	}
+	if (!result && position < text.size () && text[position] == '.')
+	{
+		++position;
+		result = digits () == 0;
+	}
+	if (!result && position < text.size () && (text[position] == 'e' || text[position] == 'E'))
+	{
+		++position;
+		if (position < text.size () && (text[position] == '+' || text[position] == '-'))
+		{
+			++position;
+		}
+		result = digits () == 0;
+	}
+	if (!result)
+	{
+		number_a.assign (text, start, position - start);
+	}
+	return result;
+}
+
+bool rai::json_reader::literal (char const * literal_a, std::string & string_a)
+{
+	auto size (std::strlen (literal_a));
+	auto result (text.compare (position, size, literal_a) != 0);
+	if (!result)
+	{
+		position += size;
+		string_a = literal_a;
+	}
+	return result;
+}
+
+size_t rai::json_reader::digits ()
+{
+	auto start (position);
+	while (position < text.size () && text[position] >= '0' && text[position] <= '9')
+	{
+		++position;
+	}
+	return position - start;
+}
+
+bool rai::json_reader::consume (char char_a)
+{
+	whitespace ();
+	auto result (position < text.size () && text[position] == char_a);
+	if (result)
+	{
+		++position;
+	}
+	return result;
+}
+
+void rai::json_reader::whitespace ()
+{
+	while (position < text.size () && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+	{
+		++position;
+	}
+}
+
 rai::rpc_config::rpc_config () :
 address (boost::asio::ip::address_v6::loopback ()),
 port (rai::rpc::rpc_port),
 enable_control (false),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+max_connections (64),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ()))
 {
 }
 
@@ -21,7 +547,9 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (rai::rpc::rpc_port),
 enable_control (enable_control_a),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+max_connections (64),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ()))
 {
 }
 
@@ -32,6 +560,8 @@ void rai::rpc_config::serialize_json (boost::property_tree::ptree & tree_a) cons
 	tree_a.put ("enable_control", enable_control);
 	tree_a.put ("frontier_request_limit", frontier_request_limit);
 	tree_a.put ("chain_request_limit", chain_request_limit);
+	tree_a.put ("max_connections", std::to_string (max_connections));
+	tree_a.put ("worker_threads", std::to_string (worker_threads));
 }
 
 bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree_a)
@@ -44,12 +574,24 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 		enable_control = tree_a.get<bool> ("enable_control");
 		auto frontier_request_limit_l (tree_a.get<std::string> ("frontier_request_limit"));
 		auto chain_request_limit_l (tree_a.get<std::string> ("chain_request_limit"));
+		auto max_connections_l (tree_a.get_optional<std::string> ("max_connections"));
+		auto worker_threads_l (tree_a.get_optional<std::string> ("worker_threads"));
 		try
 		{
 			port = std::stoul (port_l);
 			result = port > std::numeric_limits<uint16_t>::max ();
 			frontier_request_limit = std::stoull (frontier_request_limit_l);
 			chain_request_limit = std::stoull (chain_request_limit_l);
+			if (max_connections_l)
+			{
+				max_connections = std::stoul (*max_connections_l);
+				result |= max_connections == 0;
+			}
+			if (worker_threads_l)
+			{
+				worker_threads = std::stoul (*worker_threads_l);
+				result |= worker_threads == 0;
+			}
 		}
 		catch (std::logic_error const &)
 		{
@@ -71,6 +613,8 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 
 rai::rpc::rpc (boost::asio::io_service & service_a, rai::node & node_a, rai::rpc_config const & config_a) :
 acceptor (service_a),
+worker_work (new boost::asio::io_service::work (worker_service)),
+connections (std::make_shared<std::atomic<unsigned>> (0)),
 config (config_a),
 node (node_a)
 {
@@ -92,14 +636,41 @@ node (node_a)
 	});
 }
 
+rai::rpc::~rpc ()
+{
+	worker_work.reset ();
+	if (workers != nullptr)
+	{
+		workers->join ();
+	}
+}
+
 void rai::rpc::start ()
+{
+	workers.reset (new rai::thread_runner (worker_service, config.worker_threads));
+	accept ();
+}
+
+void rai::rpc::accept ()
 {
 	auto connection (std::make_shared<rai::rpc_connection> (node, *this));
 	acceptor.async_accept (connection->socket, [this, connection](boost::system::error_code const & ec) {
 		if (!ec)
 		{
-			start ();
-			connection->parse_connection ();
+			accept ();
+			connection->connections = connections;
+			if (++*connections <= config.max_connections)
+			{
+				connection->parse_connection ();
+			}
+			else
+			{
+				if (node.config.logging.log_rpc ())
+				{
+					BOOST_LOG (node.log) << boost::str (boost::format ("Refusing RPC connection, %1% connections open") % config.max_connections);
+				}
+				connection->finish ();
+			}
 		}
 		else
 		{
@@ -113,14 +684,41 @@ void rai::rpc::stop ()
 	acceptor.close ();
 }
 
-rai::rpc_handler::rpc_handler (rai::node & node_a, rai::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
+rai::rpc_handler::rpc_handler (rai::node & node_a, rai::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a, std::function<void(std::string const &, bool, std::function<void()> const &)> const & response_chunk_a) :
 body (body_a),
 node (node_a),
 rpc (rpc_a),
-response (response_a)
+response (response_a),
+response_chunk (response_chunk_a)
 {
 }
 
+void rai::rpc_handler::stream (std::shared_ptr<rai::json_writer> writer_a, std::function<bool(rai::json_writer &)> const & fill_a)
+{
+	stream_next (writer_a, std::make_shared<std::function<bool(rai::json_writer &)>> (fill_a));
+}
+
+void rai::rpc_handler::stream_next (std::shared_ptr<rai::json_writer> writer_a, std::shared_ptr<std::function<bool(rai::json_writer &)>> fill_a)
+{
+	auto done ((*fill_a) (*writer_a));
+	std::string text;
+	text.swap (writer_a->text);
+	if (done)
+	{
+		response_chunk (text, true, nullptr);
+	}
+	else
+	{
+		auto this_l (shared_from_this ());
+		response_chunk (text, false, [this_l, writer_a, fill_a]() {
+			// Resumed from the write's completion handler, the next read transaction is opened on a worker rather than the node's io_service
+			this_l->rpc.worker_service.post ([this_l, writer_a, fill_a]() {
+				this_l->stream_next (writer_a, fill_a);
+			});
+		});
+	}
+}
+
 void rai::rpc::observer_action (rai::account const & account_a)
 {
 	std::shared_ptr<rai::payment_observer> observer;
@@ -147,6 +745,15 @@ void error_response (std::function<void(boost::property_tree::ptree const &)> re
 	response_a (response_l);
 }
 
+// Throws on malformed text like property_tree's read_json
+void parse_json (std::string const & text_a, boost::property_tree::ptree & tree_a)
+{
+	if (rai::json_reader (text_a).parse (tree_a))
+	{
+		throw std::runtime_error ("Unable to parse JSON");
+	}
+}
+
 bool decode_unsigned (std::string const & text, uint64_t & number)
 {
 	bool result;
@@ -632,7 +1239,8 @@ void rai::rpc_handler::account_weight ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		auto balance (node.weight (account));
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto balance (node.ledger.weight (transaction, account));
 		boost::property_tree::ptree response_l;
 		response_l.put ("weight", balance.convert_to<std::string> ());
 		response (response_l);
@@ -760,20 +1368,21 @@ void rai::rpc_handler::accounts_pending ()
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
 	rai::uint128_union threshold (0);
 	bool source (false);
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
 	boost::optional<std::string> threshold_text (request.get_optional<std::string> ("threshold"));
-	if (threshold_text.is_initialized ())
+	if (!error && threshold_text.is_initialized ())
 	{
-		auto error_threshold (threshold.decode_dec (threshold_text.get ()));
-		if (error_threshold)
+		error = threshold.decode_dec (threshold_text.get ());
+		if (error)
 		{
 			error_response (response, "Bad threshold number");
 		}
@@ -786,11 +1395,13 @@ void rai::rpc_handler::accounts_pending ()
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree pending;
 	rai::transaction transaction (node.store.environment, nullptr, false);
-	for (auto & accounts : request.get_child ("accounts"))
+	auto & accounts (request.get_child ("accounts"));
+	for (auto j (accounts.begin ()), m (accounts.end ()); j != m && !error; ++j)
 	{
-		std::string account_text = accounts.second.data ();
+		std::string account_text = j->second.data ();
 		rai::uint256_union account;
-		if (!account.decode_account (account_text))
+		error = account.decode_account (account_text);
+		if (!error)
 		{
 			boost::property_tree::ptree peers_l;
 			rai::account end (account.number () + 1);
@@ -829,8 +1440,11 @@ void rai::rpc_handler::accounts_pending ()
 			error_response (response, "Bad account number");
 		}
 	}
-	response_l.add_child ("blocks", pending);
-	response (response_l);
+	if (!error)
+	{
+		response_l.add_child ("blocks", pending);
+		response (response_l);
+	}
 }
 
 void rai::rpc_handler::available_supply ()
@@ -1013,15 +1627,14 @@ void rai::rpc_handler::block_count ()
 {
 	rai::transaction transaction (node.store.environment, nullptr, false);
 	boost::property_tree::ptree response_l;
-	response_l.put ("count", std::to_string (node.store.block_count (transaction).sum ()));
+	response_l.put ("count", std::to_string (node.store.block_count ().sum ()));
 	response_l.put ("unchecked", std::to_string (node.store.unchecked_count (transaction)));
 	response (response_l);
 }
 
 void rai::rpc_handler::block_count_type ()
 {
-	rai::transaction transaction (node.store.environment, nullptr, false);
-	rai::block_counts count (node.store.block_count (transaction));
+	rai::block_counts count (node.store.block_count ());
 	boost::property_tree::ptree response_l;
 	response_l.put ("send", std::to_string (count.send));
 	response_l.put ("receive", std::to_string (count.receive));
@@ -1404,23 +2017,36 @@ void rai::rpc_handler::delegators ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree delegators;
-		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
-		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
+		auto writer (std::make_shared<rai::json_writer> ());
+		writer->object_begin ();
+		writer->object_begin ("delegators");
+		rai::account start (0);
+		stream (writer, [this, account, start](rai::json_writer & writer_a) mutable {
+			rai::transaction transaction (node.store.environment, nullptr, false);
+			auto i (node.store.delegators_begin (transaction, account, start));
+			auto n (node.store.delegators_end ());
+			for (; i != n && rai::delegator_key (i->first).representative == account && writer_a.text.size () < chunk_size; ++i)
 			{
+				rai::delegator_key key (i->first);
+				rai::account_info info;
+				auto error_info (node.store.account_get (transaction, key.account, info));
+				assert (!error_info);
 				std::string balance;
 				rai::uint128_union (info.balance).encode_dec (balance);
-				delegators.put (rai::account (i->first.uint256 ()).to_account (), balance);
+				writer_a.value (key.account.to_account (), balance);
 			}
-		}
-		response_l.add_child ("delegators", delegators);
-		response (response_l);
+			auto done (i == n || rai::delegator_key (i->first).representative != account);
+			if (!done)
+			{
+				start = rai::delegator_key (i->first).account;
+			}
+			else
+			{
+				writer_a.object_end ();
+				writer_a.object_end ();
+			}
+			return done;
+		});
 	}
 	else
 	{
@@ -1437,15 +2063,9 @@ void rai::rpc_handler::delegators_count ()
 	{
 		uint64_t count (0);
 		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
+		for (auto i (node.store.delegators_begin (transaction, account)), n (node.store.delegators_end ()); i != n && rai::delegator_key (i->first).representative == account; ++i)
 		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
-			{
-				++count;
-			}
+			++count;
 		}
 		boost::property_tree::ptree response_l;
 		response_l.put ("count", std::to_string (count));
@@ -1504,15 +2124,30 @@ void rai::rpc_handler::frontiers ()
 		uint64_t count;
 		if (!decode_unsigned (count_text, count))
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree frontiers;
-			rai::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && frontiers.size () < count; ++i)
-			{
-				frontiers.put (rai::account (i->first.uint256 ()).to_account (), rai::account_info (i->second).head.to_string ());
-			}
-			response_l.add_child ("frontiers", frontiers);
-			response (response_l);
+			auto writer (std::make_shared<rai::json_writer> ());
+			writer->object_begin ();
+			writer->object_begin ("frontiers");
+			uint64_t written (0);
+			stream (writer, [this, start, count, written](rai::json_writer & writer_a) mutable {
+				rai::transaction transaction (node.store.environment, nullptr, false);
+				auto i (node.store.latest_begin (transaction, start));
+				auto n (node.store.latest_end ());
+				for (; i != n && written < count && writer_a.text.size () < chunk_size; ++i, ++written)
+				{
+					writer_a.value (rai::account (i->first.uint256 ()).to_account (), rai::account_info (i->second).head.to_string ());
+				}
+				auto done (i == n || written >= count);
+				if (!done)
+				{
+					start = rai::account (i->first.uint256 ());
+				}
+				else
+				{
+					writer_a.object_end ();
+					writer_a.object_end ();
+				}
+				return done;
+			});
 		}
 		else
 		{
@@ -1737,20 +2372,21 @@ void rai::rpc_handler::ledger ()
 		rai::account start (0);
 		uint64_t count (std::numeric_limits<uint64_t>::max ());
 		bool sorting (false);
+		auto error (false);
 		boost::optional<std::string> account_text (request.get_optional<std::string> ("account"));
 		if (account_text.is_initialized ())
 		{
-			auto error (start.decode_account (account_text.get ()));
+			error = start.decode_account (account_text.get ());
 			if (error)
 			{
 				error_response (response, "Invalid starting account");
 			}
 		}
 		boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
-		if (count_text.is_initialized ())
+		if (!error && count_text.is_initialized ())
 		{
-			auto error_count (decode_unsigned (count_text.get (), count));
-			if (error_count)
+			error = decode_unsigned (count_text.get (), count);
+			if (error)
 			{
 				error_response (response, "Invalid count limit");
 			}
@@ -1778,88 +2414,100 @@ void rai::rpc_handler::ledger ()
 		{
 			pending = pending_optional.get ();
 		}
-		boost::property_tree::ptree response_a;
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree accounts;
-		rai::transaction transaction (node.store.environment, nullptr, false);
-		if (!sorting) // Simple
+		if (!error)
 		{
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && accounts.size () < count; ++i)
-			{
-				rai::account_info info (i->second);
-				rai::account account (i->first.uint256 ());
-				boost::property_tree::ptree response_l;
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
+			auto writer (std::make_shared<rai::json_writer> ());
+			writer->object_begin ();
+			writer->object_begin ("accounts");
+			uint64_t written (0);
+			auto write_account ([this, representative, weight, pending](rai::json_writer & writer_a, MDB_txn * transaction_a, rai::account const & account, rai::account_info const & info) {
+				writer_a.object_begin (account.to_account ());
+				writer_a.value ("frontier", info.head.to_string ());
+				writer_a.value ("open_block", info.open_block.to_string ());
+				writer_a.value ("representative_block", info.rep_block.to_string ());
 				std::string balance;
 				rai::uint128_union (info.balance).encode_dec (balance);
-				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
+				writer_a.value ("balance", balance);
+				writer_a.value ("modified_timestamp", std::to_string (info.modified));
+				writer_a.value ("block_count", std::to_string (info.block_count));
 				if (representative)
 				{
-					auto block (node.store.block_get (transaction, info.rep_block));
+					auto block (node.store.block_get (transaction_a, info.rep_block));
 					assert (block != nullptr);
-					response_l.put ("representative", block->representative ().to_account ());
+					writer_a.value ("representative", block->representative ().to_account ());
 				}
 				if (weight)
 				{
-					auto account_weight (node.ledger.weight (transaction, account));
-					response_l.put ("weight", account_weight.convert_to<std::string> ());
+					auto account_weight (node.ledger.weight (transaction_a, account));
+					writer_a.value ("weight", account_weight.convert_to<std::string> ());
 				}
 				if (pending)
 				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
-					response_l.put ("pending", account_pending.convert_to<std::string> ());
+					auto account_pending (node.ledger.account_pending (transaction_a, account));
+					writer_a.value ("pending", account_pending.convert_to<std::string> ());
 				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
-			}
-		}
-		else // Sorting
-		{
-			std::vector<std::pair<rai::uint128_union, rai::account>> ledger_l;
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
+				writer_a.object_end ();
+			});
+			if (!sorting) // Simple
 			{
-				rai::uint128_union balance (rai::account_info (i->second).balance);
-				ledger_l.push_back (std::make_pair (balance, rai::account (i->first.uint256 ())));
+				stream (writer, [this, start, count, written, write_account](rai::json_writer & writer_a) mutable {
+					rai::transaction transaction (node.store.environment, nullptr, false);
+					auto i (node.store.latest_begin (transaction, start));
+					auto n (node.store.latest_end ());
+					for (; i != n && written < count && writer_a.text.size () < chunk_size; ++i, ++written)
+					{
+						write_account (writer_a, transaction, rai::account (i->first.uint256 ()), rai::account_info (i->second));
+					}
+					auto done (i == n || written >= count);
+					if (!done)
+					{
+						start = rai::account (i->first.uint256 ());
+					}
+					else
+					{
+						writer_a.object_end ();
+						writer_a.object_end ();
+					}
+					return done;
+				});
 			}
-			std::sort (ledger_l.begin (), ledger_l.end ());
-			std::reverse (ledger_l.begin (), ledger_l.end ());
-			rai::account_info info;
-			for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && accounts.size () < count; ++i)
+			else // Sorting
 			{
-				node.store.account_get (transaction, i->second, info);
-				rai::account account (i->second);
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
-				std::string balance;
-				(i->first).encode_dec (balance);
-				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
-				if (representative)
-				{
-					auto block (node.store.block_get (transaction, info.rep_block));
-					assert (block != nullptr);
-					response_l.put ("representative", block->representative ().to_account ());
-				}
-				if (weight)
+				auto ledger_l (std::make_shared<std::vector<std::pair<rai::uint128_union, rai::account>>> ());
 				{
-					auto account_weight (node.ledger.weight (transaction, account));
-					response_l.put ("weight", account_weight.convert_to<std::string> ());
-				}
-				if (pending)
-				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
-					response_l.put ("pending", account_pending.convert_to<std::string> ());
+					rai::transaction transaction (node.store.environment, nullptr, false);
+					for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
+					{
+						rai::uint128_union balance (rai::account_info (i->second).balance);
+						ledger_l->push_back (std::make_pair (balance, rai::account (i->first.uint256 ())));
+					}
 				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
+				std::sort (ledger_l->begin (), ledger_l->end ());
+				std::reverse (ledger_l->begin (), ledger_l->end ());
+				size_t position (0);
+				stream (writer, [this, ledger_l, position, count, written, write_account](rai::json_writer & writer_a) mutable {
+					rai::transaction transaction (node.store.environment, nullptr, false);
+					rai::account_info info;
+					for (; position < ledger_l->size () && written < count && writer_a.text.size () < chunk_size; ++position)
+					{
+						auto & account ((*ledger_l)[position].second);
+						// Skip accounts that went away since the balances were sorted
+						if (!node.store.account_get (transaction, account, info))
+						{
+							write_account (writer_a, transaction, account, info);
+							++written;
+						}
+					}
+					auto done (position == ledger_l->size () || written >= count);
+					if (done)
+					{
+						writer_a.object_end ();
+						writer_a.object_end ();
+					}
+					return done;
+				});
 			}
 		}
-		response_a.add_child ("accounts", accounts);
-		response (response_a);
 	}
 	else
 	{
@@ -2367,8 +3015,7 @@ void rai::rpc_handler::process ()
 {
 	std::string block_text (request.get<std::string> ("block"));
 	boost::property_tree::ptree block_l;
-	std::stringstream block_stream (block_text);
-	boost::property_tree::read_json (block_stream, block_l);
+	parse_json (block_text, block_l);
 	auto block (rai::deserialize_block_json (block_l));
 	if (block != nullptr)
 	{
@@ -2655,10 +3302,11 @@ void rai::rpc_handler::representatives ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
 	bool sorting (false);
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
@@ -2669,36 +3317,60 @@ void rai::rpc_handler::representatives ()
 	{
 		sorting = sorting_optional.get ();
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree representatives;
-	rai::transaction transaction (node.store.environment, nullptr, false);
-	if (!sorting) // Simple
-	{
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n && representatives.size () < count; ++i)
-		{
-			rai::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representatives.put (account.to_account (), amount.convert_to<std::string> ());
-		}
-	}
-	else // Sorting
+	if (!error)
 	{
-		std::vector<std::pair<rai::uint128_union, std::string>> representation;
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n; ++i)
+		auto writer (std::make_shared<rai::json_writer> ());
+		writer->object_begin ();
+		writer->object_begin ("representatives");
+		uint64_t written (0);
+		if (!sorting) // Simple
 		{
-			rai::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representation.push_back (std::make_pair (amount, account.to_account ()));
+			rai::account start (0);
+			stream (writer, [this, start, count, written](rai::json_writer & writer_a) mutable {
+				rai::transaction transaction (node.store.environment, nullptr, false);
+				auto i (node.store.representation_begin (transaction, start));
+				auto n (node.store.representation_end ());
+				for (; i != n && written < count && writer_a.text.size () < chunk_size; ++i, ++written)
+				{
+					rai::uint128_union amount;
+					rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+					auto error_amount (rai::read (stream, amount));
+					assert (!error_amount);
+					writer_a.value (rai::account (i->first.uint256 ()).to_account (), amount.number ().convert_to<std::string> ());
+				}
+				auto done (i == n || written >= count);
+				if (!done)
+				{
+					start = rai::account (i->first.uint256 ());
+				}
+				else
+				{
+					writer_a.object_end ();
+					writer_a.object_end ();
+				}
+				return done;
+			});
 		}
-		std::sort (representation.begin (), representation.end ());
-		std::reverse (representation.begin (), representation.end ());
-		for (auto i (representation.begin ()), n (representation.end ()); i != n && representatives.size () < count; ++i)
+		else // Sorting
 		{
-			representatives.put (i->second, (i->first).number ().convert_to<std::string> ());
+			auto representation (std::make_shared<std::vector<rai::representation_entry>> (node.store.representation_top (std::min<uint64_t> (count, std::numeric_limits<size_t>::max ()))));
+			size_t position (0);
+			stream (writer, [representation, position](rai::json_writer & writer_a) mutable {
+				for (; position < representation->size () && writer_a.text.size () < chunk_size; ++position)
+				{
+					auto & entry ((*representation)[position]);
+					writer_a.value (entry.representative.to_account (), entry.weight.convert_to<std::string> ());
+				}
+				auto done (position == representation->size ());
+				if (done)
+				{
+					writer_a.object_end ();
+					writer_a.object_end ();
+				}
+				return done;
+			});
 		}
 	}
-	response_l.add_child ("representatives", representatives);
-	response (response_l);
 }
 
 void rai::rpc_handler::republish ()
@@ -3002,28 +3674,66 @@ void rai::rpc_handler::stop ()
 void rai::rpc_handler::unchecked ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree unchecked;
-	rai::transaction transaction (node.store.environment, nullptr, false);
-	for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
+	if (!error)
 	{
-		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (rai::deserialize_block (stream));
-		std::string contents;
-		block->serialize_json (contents);
-		unchecked.put (block->hash ().to_string (), contents);
+		auto writer (std::make_shared<rai::json_writer> ());
+		writer->object_begin ();
+		writer->object_begin ("blocks");
+		// Where the next chunk picks up, the key and the serialized block under it
+		rai::block_hash start (0);
+		std::vector<uint8_t> resume;
+		// A block received again with different work is stored twice under the same key, it's listed once per key
+		rai::block_hash listed_key (0);
+		std::unordered_set<rai::block_hash> listed;
+		uint64_t written (0);
+		stream (writer, [this, start, resume, listed_key, listed, written, count](rai::json_writer & writer_a) mutable {
+			rai::transaction transaction (node.store.environment, nullptr, false);
+			auto i (resume.empty () ? node.store.unchecked_begin (transaction) : node.store.unchecked_begin (transaction, start, rai::mdb_val (resume.size (), resume.data ())));
+			auto n (node.store.unchecked_end ());
+			for (; i != n && written < count && writer_a.text.size () < chunk_size; ++i)
+			{
+				rai::block_hash key (i->first.uint256 ());
+				if (key != listed_key)
+				{
+					listed_key = key;
+					listed.clear ();
+				}
+				rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+				auto block (rai::deserialize_block (stream));
+				auto hash (block->hash ());
+				if (listed.insert (hash).second)
+				{
+					std::string contents;
+					block->serialize_json (contents);
+					writer_a.value (hash.to_string (), contents);
+					++written;
+				}
+			}
+			auto done (i == n || written >= count);
+			if (!done)
+			{
+				start = rai::block_hash (i->first.uint256 ());
+				auto data (reinterpret_cast<uint8_t const *> (i->second.data ()));
+				resume.assign (data, data + i->second.size ());
+			}
+			else
+			{
+				writer_a.object_end ();
+				writer_a.object_end ();
+			}
+			return done;
+		});
 	}
-	response_l.add_child ("blocks", unchecked);
-	response (response_l);
 }
 
 void rai::rpc_handler::unchecked_clear ()
@@ -3577,17 +4287,17 @@ void rai::rpc_handler::wallet_pending ()
 			boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 			if (count_text.is_initialized ())
 			{
-				auto error (decode_unsigned (count_text.get (), count));
+				error = decode_unsigned (count_text.get (), count);
 				if (error)
 				{
 					error_response (response, "Invalid count limit");
 				}
 			}
 			boost::optional<std::string> threshold_text (request.get_optional<std::string> ("threshold"));
-			if (threshold_text.is_initialized ())
+			if (!error && threshold_text.is_initialized ())
 			{
-				auto error_threshold (threshold.decode_dec (threshold_text.get ()));
-				if (error_threshold)
+				error = threshold.decode_dec (threshold_text.get ());
+				if (error)
 				{
 					error_response (response, "Bad threshold number");
 				}
@@ -3597,49 +4307,110 @@ void rai::rpc_handler::wallet_pending ()
 			{
 				source = source_optional.get ();
 			}
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree pending;
-			rai::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+			if (!error)
 			{
-				rai::account account (i->first.uint256 ());
-				boost::property_tree::ptree peers_l;
-				rai::account end (account.number () + 1);
-				for (auto ii (node.store.pending_begin (transaction, rai::pending_key (account, 0))), nn (node.store.pending_begin (transaction, rai::pending_key (end, 0))); ii != nn && peers_l.size () < count; ++ii)
-				{
-					rai::pending_key key (ii->first);
-					if (threshold.is_zero () && !source)
-					{
-						boost::property_tree::ptree entry;
-						entry.put ("", key.hash.to_string ());
-						peers_l.push_back (std::make_pair ("", entry));
-					}
-					else
+				auto hashes_only (threshold.is_zero () && !source);
+				auto writer (std::make_shared<rai::json_writer> ());
+				writer->object_begin ();
+				writer->object_begin ("blocks");
+				auto wallet_l (existing->second);
+				// Where the next chunk picks up, the wallet account and the pending block within it
+				rai::account account (rai::wallet_store::special_count);
+				rai::block_hash resume (0);
+				uint64_t written (0);
+				stream (writer, [this, wallet_l, count, threshold, source, hashes_only, account, resume, written](rai::json_writer & writer_a) mutable {
+					auto close_account ([&]() {
+						// Accounts with nothing pending are left out
+						if (written != 0)
+						{
+							if (hashes_only)
+							{
+								writer_a.array_end ();
+							}
+							else
+							{
+								writer_a.object_end ();
+							}
+						}
+						written = 0;
+						resume.clear ();
+					});
+					rai::transaction transaction (node.store.environment, nullptr, false);
+					auto i (wallet_l->store.begin (transaction, account));
+					auto n (wallet_l->store.end ());
+					auto full (false);
+					while (i != n && !full)
 					{
-						rai::pending_info info (ii->second);
-						if (info.amount.number () >= threshold.number ())
+						rai::account next (i->first.uint256 ());
+						if (next != account)
+						{
+							close_account ();
+							account = next;
+						}
+						rai::account end (account.number () + 1);
+						auto ii (node.store.pending_begin (transaction, rai::pending_key (account, resume)));
+						auto nn (node.store.pending_begin (transaction, rai::pending_key (end, 0)));
+						for (; ii != nn && written < count && !full; ++ii)
 						{
-							if (source)
+							rai::pending_key key (ii->first);
+							if (hashes_only)
 							{
-								boost::property_tree::ptree pending_tree;
-								pending_tree.put ("amount", info.amount.number ().convert_to<std::string> ());
-								pending_tree.put ("source", info.source.to_account ());
-								peers_l.add_child (key.hash.to_string (), pending_tree);
+								if (written == 0)
+								{
+									writer_a.array_begin (account.to_account ());
+								}
+								writer_a.value (key.hash.to_string ());
+								++written;
 							}
 							else
 							{
-								peers_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+								rai::pending_info info (ii->second);
+								if (info.amount.number () >= threshold.number ())
+								{
+									if (written == 0)
+									{
+										writer_a.object_begin (account.to_account ());
+									}
+									if (source)
+									{
+										writer_a.object_begin (key.hash.to_string ());
+										writer_a.value ("amount", info.amount.number ().convert_to<std::string> ());
+										writer_a.value ("source", info.source.to_account ());
+										writer_a.object_end ();
+									}
+									else
+									{
+										writer_a.value (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+									}
+									++written;
+								}
+							}
+							full = writer_a.text.size () >= chunk_size;
+						}
+						if (ii != nn && written < count)
+						{
+							// The chunk filled up partway through this account
+							resume = rai::pending_key (ii->first).hash;
+						}
+						else
+						{
+							close_account ();
+							++i;
+							if (i != n)
+							{
+								account = rai::account (i->first.uint256 ());
 							}
 						}
 					}
-				}
-				if (!peers_l.empty ())
-				{
-					pending.add_child (account.to_account (), peers_l);
-				}
+					auto done (i == n);
+					if (done)
+					{
+						writer_a.object_end ();
+						writer_a.object_end ();
+					}
+					return done;
+				});
 			}
-			response_l.add_child ("blocks", pending);
-			response (response_l);
 		}
 		else
 		{
@@ -4104,43 +4875,97 @@ void rai::rpc_handler::work_peers_clear ()
 rai::rpc_connection::rpc_connection (rai::node & node_a, rai::rpc & rpc_a) :
 node (node_a.shared ()),
 rpc (rpc_a),
-socket (node_a.service)
+socket (node_a.service),
+timeout (node_a.service),
+chunked (false)
+{
+}
+
+rai::rpc_connection::~rpc_connection ()
 {
+	if (connections != nullptr)
+	{
+		--*connections;
+	}
+}
+
+void rai::rpc_connection::start_timeout (std::chrono::seconds timeout_a)
+{
+	timeout.expires_from_now (boost::posix_time::seconds (timeout_a.count ()));
+	std::weak_ptr<rai::rpc_connection> this_w (shared_from_this ());
+	timeout.async_wait ([this_w](boost::system::error_code const & ec) {
+		if (ec != boost::asio::error::operation_aborted)
+		{
+			auto this_l (this_w.lock ());
+			if (this_l != nullptr)
+			{
+				this_l->finish ();
+			}
+		}
+	});
+}
+
+void rai::rpc_connection::stop_timeout ()
+{
+	size_t killed (timeout.cancel ());
+	(void)killed;
 }
 
 void rai::rpc_connection::parse_connection ()
 {
 	auto this_l (shared_from_this ());
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	chunked = false;
+	start_timeout (read_timeout);
 	boost::beast::http::async_read (socket, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->stop_timeout ();
 		if (!ec)
 		{
-			this_l->node->background ([this_l]() {
+			// Set by the first response to this request, later ones are dropped
+			auto responded (std::make_shared<std::atomic<bool>> (false));
+			auto chunking (std::make_shared<std::atomic<bool>> (false));
+			this_l->rpc.worker_service.post ([this_l, responded, chunking]() {
 				auto start (std::chrono::steady_clock::now ());
 				auto version (this_l->request.version ());
-				auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->res.set ("Content-Type", "application/json");
-					this_l->res.set ("Access-Control-Allow-Origin", "*");
-					this_l->res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
-					this_l->res.set ("Connection", "close");
-					this_l->res.result (boost::beast::http::status::ok);
-					this_l->res.body () = body;
-					this_l->res.version (version);
-					this_l->res.prepare_payload ();
-					//boost::beast::http::prepare (this_l->res);
-					boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-					});
+				auto keep_alive (this_l->request.keep_alive ());
+				auto completed ([this_l, start]() {
 					if (this_l->node->config.logging.log_rpc ())
 					{
 						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
 					}
 				});
+				auto response_handler ([this_l, version, keep_alive, completed, responded](boost::property_tree::ptree const & tree_a) {
+					if (!responded->exchange (true))
+					{
+						rai::json_writer writer;
+						writer.tree (tree_a);
+						this_l->write_response (writer.text, version, keep_alive);
+						completed ();
+					}
+					else
+					{
+						this_l->duplicate_response ();
+					}
+				});
+				auto response_chunk ([this_l, version, keep_alive, completed, responded, chunking](std::string const & body_a, bool last_a, std::function<void()> const & next_a) {
+					// Later pieces of a chunked response belong to the response the first piece started
+					if (chunking->load () || !responded->exchange (true))
+					{
+						chunking->store (true);
+						this_l->write_chunk (body_a, last_a, version, keep_alive, next_a);
+						if (last_a)
+						{
+							completed ();
+						}
+					}
+					else
+					{
+						this_l->duplicate_response ();
+					}
+				});
 				if (this_l->request.method () == boost::beast::http::verb::post)
 				{
-					auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
+					auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler, response_chunk));
 					handler->process_request ();
 				}
 				else
@@ -4149,9 +4974,130 @@ void rai::rpc_connection::parse_connection ()
 				}
 			});
 		}
+		else
+		{
+			this_l->finish ();
+		}
+	});
+}
+
+void rai::rpc_connection::write_response (std::string const & body_a, unsigned version_a, bool keep_alive_a)
+{
+	auto this_l (shared_from_this ());
+	res = boost::beast::http::response<boost::beast::http::string_body> ();
+	res.set ("Content-Type", "application/json");
+	res.set ("Access-Control-Allow-Origin", "*");
+	res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+	res.result (boost::beast::http::status::ok);
+	res.body () = body_a;
+	res.version (version_a);
+	res.keep_alive (keep_alive_a);
+	res.prepare_payload ();
+	boost::beast::http::async_write (socket, res, [this_l, keep_alive_a](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec && keep_alive_a)
+		{
+			// Pipelined requests are already sitting in buffer and are answered in order
+			this_l->parse_connection ();
+		}
+		else
+		{
+			this_l->finish ();
+		}
 	});
 }
 
+void rai::rpc_connection::write_chunk (std::string const & body_a, bool last_a, unsigned version_a, bool keep_alive_a, std::function<void()> const & next_a)
+{
+	if (!chunked && last_a)
+	{
+		// Everything fit in one chunk, send it as a plain response
+		write_response (body_a, version_a, keep_alive_a);
+	}
+	else
+	{
+		// HTTP/1.0 has no chunked encoding, the body is sent without a length and ends when the connection is closed
+		auto encode (version_a >= 11);
+		auto keep_alive (encode && keep_alive_a);
+		auto wire (std::make_shared<std::string> ());
+		if (!chunked)
+		{
+			chunked = true;
+			boost::beast::http::response<boost::beast::http::empty_body> header;
+			header.set ("Content-Type", "application/json");
+			header.set ("Access-Control-Allow-Origin", "*");
+			header.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+			header.result (boost::beast::http::status::ok);
+			header.version (version_a);
+			header.keep_alive (keep_alive);
+			if (encode)
+			{
+				header.chunked (true);
+			}
+			std::stringstream stream;
+			stream << header.base ();
+			*wire = stream.str ();
+		}
+		if (encode)
+		{
+			// An empty chunk would end the body early
+			if (!body_a.empty ())
+			{
+				*wire += boost::str (boost::format ("%1$x\r\n") % body_a.size ());
+				*wire += body_a;
+				*wire += "\r\n";
+			}
+			if (last_a)
+			{
+				*wire += "0\r\n\r\n";
+			}
+		}
+		else
+		{
+			*wire += body_a;
+		}
+		auto this_l (shared_from_this ());
+		// A client that stops reading is disconnected rather than left holding the rest of the listing
+		start_timeout (write_timeout);
+		boost::asio::async_write (socket, boost::asio::buffer (*wire), [this_l, wire, last_a, keep_alive, next_a](boost::system::error_code const & ec, size_t bytes_transferred) {
+			this_l->stop_timeout ();
+			if (!ec)
+			{
+				if (!last_a)
+				{
+					next_a ();
+				}
+				else if (keep_alive)
+				{
+					this_l->parse_connection ();
+				}
+				else
+				{
+					this_l->finish ();
+				}
+			}
+			else
+			{
+				this_l->finish ();
+			}
+		});
+	}
+}
+
+void rai::rpc_connection::finish ()
+{
+	boost::system::error_code ignored;
+	socket.shutdown (boost::asio::ip::tcp::socket::shutdown_both, ignored);
+	socket.close (ignored);
+}
+
+void rai::rpc_connection::duplicate_response ()
+{
+	if (node->config.logging.log_rpc ())
+	{
+		BOOST_LOG (node->log) << boost::str (boost::format ("RPC request %1% already has a response, dropping another") % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this)));
+	}
+}
+
 namespace
 {
 void reprocess_body (std::string & body, boost::property_tree::ptree & tree_a)
@@ -4166,8 +5112,7 @@ void rai::rpc_handler::process_request ()
 {
 	try
 	{
-		std::stringstream istream (body);
-		boost::property_tree::read_json (istream, request);
+		parse_json (body, request);
 		std::string action (request.get<std::string> ("action"));
 		if (action == "password_enter")
 		{
@@ -16,6 +16,57 @@
 namespace rai
 {
 class node;
+// Appends compact JSON to text as it is produced, scalars are written as strings the way property_tree writes them
+class json_writer
+{
+public:
+	void object_begin ();
+	void object_begin (std::string const &);
+	void object_end ();
+	void array_begin ();
+	void array_begin (std::string const &);
+	void array_end ();
+	void value (std::string const &);
+	void value (std::string const &, std::string const &);
+	void tree (boost::property_tree::ptree const &);
+	void tree (std::string const &, boost::property_tree::ptree const &);
+	std::string text;
+
+private:
+	void key (std::string const &);
+	void separator ();
+	void open (char);
+	void close (char);
+	void string (std::string const &);
+	void tree_value (boost::property_tree::ptree const &);
+	void object_value (boost::property_tree::ptree const &);
+	std::vector<bool> first;
+};
+// Reads a JSON document in one pass without a stream, scalars are stored as their text the way read_json stores them
+class json_reader
+{
+public:
+	json_reader (std::string const &);
+	// Returns true if the text isn't well formed JSON
+	bool parse (boost::property_tree::ptree &);
+	static size_t constexpr max_depth = 64;
+
+private:
+	bool value (boost::property_tree::ptree &, size_t);
+	bool object (boost::property_tree::ptree &, size_t);
+	bool array (boost::property_tree::ptree &, size_t);
+	bool string (std::string &);
+	bool escape (std::string &);
+	bool hex (unsigned &);
+	bool number (std::string &);
+	bool literal (char const *, std::string &);
+	size_t digits ();
+	// Skips whitespace and consumes the character if it's next, returning whether it was
+	bool consume (char);
+	void whitespace ();
+	std::string const & text;
+	size_t position;
+};
 class rpc_config
 {
 public:
@@ -28,6 +79,9 @@ public:
 	bool enable_control;
 	uint64_t frontier_request_limit;
 	uint64_t chain_request_limit;
+	// Connections accepted beyond this are closed immediately
+	unsigned max_connections;
+	unsigned worker_threads;
 };
 enum class payment_status
 {
@@ -41,14 +95,23 @@ enum class payment_status
 };
 class wallet;
 class payment_observer;
+class thread_runner;
 class rpc
 {
 public:
 	rpc (boost::asio::io_service &, rai::node &, rai::rpc_config const &);
+	~rpc ();
 	void start ();
+	void accept ();
 	void stop ();
 	void observer_action (rai::account const &);
 	boost::asio::ip::tcp::acceptor acceptor;
+	// Requests are handled here rather than on the node's io_service, the threads are started by start ()
+	boost::asio::io_service worker_service;
+	std::unique_ptr<boost::asio::io_service::work> worker_work;
+	std::unique_ptr<rai::thread_runner> workers;
+	// Shared with each accepted connection, a keep-alive connection parked on the node's io_service can outlive the server
+	std::shared_ptr<std::atomic<unsigned>> connections;
 	std::mutex mutex;
 	std::unordered_map<rai::account, std::shared_ptr<rai::payment_observer>> payment_observers;
 	rai::rpc_config config;
@@ -60,13 +123,29 @@ class rpc_connection : public std::enable_shared_from_this<rai::rpc_connection>
 {
 public:
 	rpc_connection (rai::node &, rai::rpc &);
+	~rpc_connection ();
 	void parse_connection ();
+	void start_timeout (std::chrono::seconds);
+	void stop_timeout ();
+	void write_response (std::string const &, unsigned, bool);
+	// Writes the next piece of a chunked response without waiting for it, the function is called once a piece other than the last has been sent
+	void write_chunk (std::string const &, bool, unsigned, bool, std::function<void()> const &);
+	void finish ();
+	void duplicate_response ();
 	std::shared_ptr<rai::node> node;
 	rai::rpc & rpc;
 	boost::asio::ip::tcp::socket socket;
+	boost::asio::deadline_timer timeout;
 	boost::beast::flat_buffer buffer;
 	boost::beast::http::request<boost::beast::http::string_body> request;
 	boost::beast::http::response<boost::beast::http::string_body> res;
+	bool chunked;
+	// Set once the acceptor has counted this connection, the connection gives its slot back through it rather than through rpc
+	std::shared_ptr<std::atomic<unsigned>> connections;
+	// An idle connection waiting for a request is closed after this long so it doesn't hold one of max_connections
+	static std::chrono::seconds constexpr read_timeout = std::chrono::seconds (30);
+	// A chunk that can't be written within this time closes the connection
+	static std::chrono::seconds constexpr write_timeout = std::chrono::seconds (30);
 };
 class payment_observer : public std::enable_shared_from_this<rai::payment_observer>
 {
@@ -88,8 +167,12 @@ public:
 class rpc_handler : public std::enable_shared_from_this<rai::rpc_handler>
 {
 public:
-	rpc_handler (rai::node &, rai::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &);
+	rpc_handler (rai::node &, rai::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &, std::function<void(std::string const &, bool, std::function<void()> const &)> const &);
 	void process_request ();
+	// Streams a body in chunks, the function adds about chunk_size more to the writer each call and returns true once it has closed the body
+	// It's called again on a worker only after the previous chunk has been written, so no thread waits on a slow client
+	void stream (std::shared_ptr<rai::json_writer>, std::function<bool(rai::json_writer &)> const &);
+	void stream_next (std::shared_ptr<rai::json_writer>, std::shared_ptr<std::function<bool(rai::json_writer &)>>);
 	void account_balance ();
 	void account_block_count ();
 	void account_create ();
@@ -190,5 +273,9 @@ public:
 	rai::rpc & rpc;
 	boost::property_tree::ptree request;
 	std::function<void(boost::property_tree::ptree const &)> response;
+	// Sends part of a body written with rai::json_writer, the last part finishes the response. The function is called once a part other than the last is sent, never if the client has gone away
+	std::function<void(std::string const &, bool, std::function<void()> const &)> response_chunk;
+	// Listings are streamed in chunks of about this size, with the read transaction released between them
+	static size_t constexpr chunk_size = 64 * 1024;
 };
 }
@@ -753,7 +753,7 @@ std::string rai_qt::status::text ()
 	std::string count_string;
 	{
 		rai::transaction transaction (wallet.wallet_m->node.store.environment, nullptr, false);
-		auto size (wallet.wallet_m->node.store.block_count (transaction));
+		auto size (wallet.wallet_m->node.store.block_count ());
 		unchecked = wallet.wallet_m->node.store.unchecked_count (transaction);
 		count_string = std::to_string (size.sum ());
 	}
@@ -125,6 +125,7 @@ int main (int argc, char * const * argv)
 		("debug_profile_generate", "Profile work generation")
 		("debug_opencl", "OpenCL work generation")
 		("debug_profile_verify", "Profile work verification")
+		("debug_profile_verify_batch", "Profile batched work verification")
 		("debug_profile_kdf", "Profile kdf function")
 		("debug_verify_profile", "Profile signature verification")
 		("debug_profile_sign", "Profile signature generation")
@@ -158,8 +159,7 @@ int main (int argc, char * const * argv)
 	else if (vm.count ("debug_block_count"))
 	{
 		rai::inactive_node node;
-		rai::transaction transaction (node.node->store.environment, nullptr, false);
-		std::cout << boost::str (boost::format ("Block count: %1%\n") % node.node->store.block_count (transaction).sum ());
+		std::cout << boost::str (boost::format ("Block count: %1%\n") % node.node->store.block_count ().sum ());
 	}
 	else if (vm.count ("debug_bootstrap_generate"))
 	{
@@ -392,6 +392,28 @@ int main (int argc, char * const * argv)
 			std::cerr << boost::str (boost::format ("%|1$ 12d|\n") % std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count ());
 		}
 	}
+	else if (vm.count ("debug_profile_verify_batch"))
+	{
+		std::vector<rai::block_hash> roots (1024);
+		std::vector<uint64_t> works (roots.size ());
+		std::unique_ptr<bool[]> results (new bool[roots.size ()]);
+		std::cerr << "Starting batched verification profiling\n";
+		for (uint64_t i (0); true; ++i)
+		{
+			auto begin1 (std::chrono::high_resolution_clock::now ());
+			for (uint64_t t (0); t < 1000000; t += roots.size ())
+			{
+				for (size_t j (0); j < roots.size (); ++j)
+				{
+					roots[j].qwords[0] = t + j;
+					works[j] = t + j;
+				}
+				rai::work_validate_batch (roots.data (), works.data (), roots.size (), results.get ());
+			}
+			auto end1 (std::chrono::high_resolution_clock::now ());
+			std::cerr << boost::str (boost::format ("%|1$ 12d|\n") % std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count ());
+		}
+	}
 	else if (vm.count ("debug_verify_profile"))
 	{
 		rai::keypair key;
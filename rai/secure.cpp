@@ -7,6 +7,8 @@
 
 #include <boost/property_tree/json_parser.hpp>
 
+#include <cmath>
+#include <cstring>
 #include <queue>
 
 #include <ed25519-donna/ed25519.h>
@@ -136,35 +138,19 @@ bool rai::shared_ptr_block_hash::operator() (std::shared_ptr<rai::block> const &
 	return *lhs == *rhs;
 }
 
-// Sum the weights for each vote and return the winning block with its vote tally
+// Return the winning block with its vote tally from the running totals
 std::pair<rai::uint128_t, std::shared_ptr<rai::block>> rai::ledger::winner (MDB_txn * transaction_a, rai::votes const & votes_a)
 {
-	auto tally_l (tally (transaction_a, votes_a));
-	auto existing (tally_l.begin ());
-	return std::make_pair (existing->first, existing->second);
+	return votes_a.winner ();
 }
 
 std::map<rai::uint128_t, std::shared_ptr<rai::block>, std::greater<rai::uint128_t>> rai::ledger::tally (MDB_txn * transaction_a, rai::votes const & votes_a)
 {
-	std::unordered_map<std::shared_ptr<block>, rai::uint128_t, rai::shared_ptr_block_hash, rai::shared_ptr_block_hash> totals;
-	// Construct a map of blocks -> vote total.
-	for (auto & i : votes_a.rep_votes)
-	{
-		auto existing (totals.find (i.second));
-		if (existing == totals.end ())
-		{
-			totals.insert (std::make_pair (i.second, 0));
-			existing = totals.find (i.second);
-			assert (existing != totals.end ());
-		}
-		auto weight_l (weight (transaction_a, i.first));
-		existing->second += weight_l;
-	}
-	// Construction a map of vote total -> block in decreasing order.
+	// Construct a map of vote total -> block in decreasing order from the running totals.
 	std::map<rai::uint128_t, std::shared_ptr<rai::block>, std::greater<rai::uint128_t>> result;
-	for (auto & i : totals)
+	for (auto & i : votes_a.totals)
 	{
-		result[i.second] = i.first;
+		result[i.second.first] = i.first;
 	}
 	return result;
 }
@@ -173,9 +159,11 @@ rai::votes::votes (std::shared_ptr<rai::block> block_a) :
 id (block_a->root ())
 {
 	rep_votes.insert (std::make_pair (rai::not_an_account, block_a));
+	rep_weights.insert (std::make_pair (rai::not_an_account, 0));
+	add (block_a, 0);
 }
 
-rai::tally_result rai::votes::vote (std::shared_ptr<rai::vote> vote_a)
+rai::tally_result rai::votes::vote (std::shared_ptr<rai::vote> vote_a, rai::uint128_t const & weight_a)
 {
 	rai::tally_result result;
 	auto existing (rep_votes.find (vote_a->account));
@@ -184,9 +172,13 @@ rai::tally_result rai::votes::vote (std::shared_ptr<rai::vote> vote_a)
 		// Vote on this block hasn't been seen from rep before
 		result = rai::tally_result::vote;
 		rep_votes.insert (std::make_pair (vote_a->account, vote_a->block));
+		rep_weights[vote_a->account] = weight_a;
+		add (vote_a->block, weight_a);
 	}
 	else
 	{
+		auto & weight_l (rep_weights[vote_a->account]);
+		remove (existing->second, weight_l);
 		if (!(*existing->second == *vote_a->block))
 		{
 			// Rep changed their vote
@@ -198,10 +190,48 @@ rai::tally_result rai::votes::vote (std::shared_ptr<rai::vote> vote_a)
 			// Rep vote remained the same
 			result = rai::tally_result::confirm;
 		}
+		// Recount with the rep's current weight
+		weight_l = weight_a;
+		add (existing->second, weight_l);
+	}
+	return result;
+}
+
+std::pair<rai::uint128_t, std::shared_ptr<rai::block>> rai::votes::winner () const
+{
+	assert (!totals.empty ());
+	auto result (std::make_pair (rai::uint128_t (0), totals.begin ()->first));
+	for (auto & i : totals)
+	{
+		if (i.second.first > result.first)
+		{
+			result = std::make_pair (i.second.first, i.first);
+		}
 	}
 	return result;
 }
 
+void rai::votes::add (std::shared_ptr<rai::block> block_a, rai::uint128_t const & weight_a)
+{
+	auto & total (totals[block_a]);
+	total.first += weight_a;
+	++total.second;
+}
+
+void rai::votes::remove (std::shared_ptr<rai::block> block_a, rai::uint128_t const & weight_a)
+{
+	auto existing (totals.find (block_a));
+	assert (existing != totals.end ());
+	assert (existing->second.first >= weight_a);
+	assert (existing->second.second > 0);
+	existing->second.first -= weight_a;
+	if (--existing->second.second == 0)
+	{
+		// Nobody votes for this block anymore
+		totals.erase (existing);
+	}
+}
+
 // Create a new random keypair
 rai::keypair::keypair ()
 {
@@ -378,6 +408,38 @@ cursor (nullptr)
 	}
 }
 
+rai::store_iterator::store_iterator (MDB_txn * transaction_a, MDB_dbi db_a, MDB_val const & key_a, MDB_val const & value_a) :
+cursor (nullptr)
+{
+	auto status (mdb_cursor_open (transaction_a, db_a, &cursor));
+	assert (status == 0);
+	current.first.value = key_a;
+	current.second.value = value_a;
+	auto status2 (mdb_cursor_get (cursor, &current.first.value, &current.second.value, MDB_GET_BOTH_RANGE));
+	assert (status2 == 0 || status2 == MDB_NOTFOUND);
+	if (status2 == MDB_NOTFOUND)
+	{
+		// Nothing left under key, start from the key after it
+		current.first.value = key_a;
+		status2 = mdb_cursor_get (cursor, &current.first.value, &current.second.value, MDB_SET_RANGE);
+		assert (status2 == 0 || status2 == MDB_NOTFOUND);
+		if (status2 != MDB_NOTFOUND && current.first.size () == key_a.mv_size && std::memcmp (current.first.data (), key_a.mv_data, key_a.mv_size) == 0)
+		{
+			status2 = mdb_cursor_get (cursor, &current.first.value, &current.second.value, MDB_NEXT_NODUP);
+			assert (status2 == 0 || status2 == MDB_NOTFOUND);
+		}
+	}
+	if (status2 != MDB_NOTFOUND)
+	{
+		auto status3 (mdb_cursor_get (cursor, &current.first.value, &current.second.value, MDB_GET_CURRENT));
+		assert (status3 == 0 || status3 == MDB_NOTFOUND);
+	}
+	else
+	{
+		current.clear ();
+	}
+}
+
 rai::store_iterator::store_iterator (rai::store_iterator && other_a)
 {
 	cursor = other_a.cursor;
@@ -454,17 +516,65 @@ size_t rai::block_counts::sum ()
 	return send + receive + open + change;
 }
 
-rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs) :
+size_t const rai::block_filter::capacity_min;
+
+rai::block_filter::block_filter (size_t capacity_a, double fp_rate_a) :
+capacity (capacity_a)
+{
+	assert (fp_rate_a > 0.0 && fp_rate_a < 1.0);
+	auto ln2 (std::log (2.0));
+	auto bits_l (static_cast<size_t> (std::ceil (capacity_a * -std::log (fp_rate_a) / (ln2 * ln2))));
+	// Round up to a power of two so probes are a mask instead of a division
+	bits = 64;
+	while (bits < bits_l)
+	{
+		bits <<= 1;
+	}
+	hashes = std::max (1u, static_cast<unsigned> (std::round (-std::log (fp_rate_a) / ln2)));
+	words.reset (new std::atomic<uint64_t>[bits / 64]);
+	for (size_t i (0), n (bits / 64); i < n; ++i)
+	{
+		words[i].store (0, std::memory_order_relaxed);
+	}
+}
+
+void rai::block_filter::insert (rai::block_hash const & hash_a)
+{
+	// Block hashes are uniformly distributed so double hashing over two of their words is enough
+	auto probe (hash_a.qwords[0]);
+	auto step (hash_a.qwords[1] | 1);
+	for (auto i (0u); i < hashes; ++i, probe += step)
+	{
+		auto bit (probe & (bits - 1));
+		words[bit / 64].fetch_or (uint64_t (1) << (bit % 64), std::memory_order_release);
+	}
+}
+
+bool rai::block_filter::may_contain (rai::block_hash const & hash_a) const
+{
+	auto result (true);
+	auto probe (hash_a.qwords[0]);
+	auto step (hash_a.qwords[1] | 1);
+	for (auto i (0u); result && i < hashes; ++i, probe += step)
+	{
+		auto bit (probe & (bits - 1));
+		result = (words[bit / 64].load (std::memory_order_acquire) & (uint64_t (1) << (bit % 64))) != 0;
+	}
+	return result;
+}
+
+rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs, double block_filter_fp_rate_a) :
+block_filter_stopped (false),
+block_filter_fp_rate (block_filter_fp_rate_a),
+representation_cache_minimum (rai::rai_network == rai::rai_networks::rai_test_network ? 0 : rai::Mxrb_ratio),
 environment (error_a, path_a, lmdb_max_dbs),
 frontiers (0),
 accounts (0),
-send_blocks (0),
-receive_blocks (0),
-open_blocks (0),
-change_blocks (0),
+blocks (0),
 pending (0),
 blocks_info (0),
 representation (0),
+delegators (0),
 unchecked (0),
 unsynced (0),
 checksum (0)
@@ -474,13 +584,11 @@ checksum (0)
 		rai::transaction transaction (environment, nullptr, true);
 		error_a |= mdb_dbi_open (transaction, "frontiers", MDB_CREATE, &frontiers) != 0;
 		error_a |= mdb_dbi_open (transaction, "accounts", MDB_CREATE, &accounts) != 0;
-		error_a |= mdb_dbi_open (transaction, "send", MDB_CREATE, &send_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "receive", MDB_CREATE, &receive_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "open", MDB_CREATE, &open_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "change", MDB_CREATE, &change_blocks) != 0;
+		error_a |= mdb_dbi_open (transaction, "blocks", MDB_CREATE, &blocks) != 0;
 		error_a |= mdb_dbi_open (transaction, "pending", MDB_CREATE, &pending) != 0;
 		error_a |= mdb_dbi_open (transaction, "blocks_info", MDB_CREATE, &blocks_info) != 0;
 		error_a |= mdb_dbi_open (transaction, "representation", MDB_CREATE, &representation) != 0;
+		error_a |= mdb_dbi_open (transaction, "delegators", MDB_CREATE, &delegators) != 0;
 		error_a |= mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &unchecked) != 0;
 		error_a |= mdb_dbi_open (transaction, "unsynced", MDB_CREATE, &unsynced) != 0;
 		error_a |= mdb_dbi_open (transaction, "checksum", MDB_CREATE, &checksum) != 0;
@@ -488,12 +596,26 @@ checksum (0)
 		error_a |= mdb_dbi_open (transaction, "meta", MDB_CREATE, &meta) != 0;
 		if (!error_a)
 		{
+			block_count_load (transaction);
 			do_upgrades (transaction);
+			block_count_put (transaction);
 			checksum_put (transaction, 0, 0, 0);
+			representation_cache_load (transaction);
+			// Built before the store is shared with any other thread
+			block_filter_rebuild (transaction);
 		}
 	}
 }
 
+rai::block_store::~block_store ()
+{
+	block_filter_stopped = true;
+	if (block_filter_thread.joinable ())
+	{
+		block_filter_thread.join ();
+	}
+}
+
 void rai::block_store::version_put (MDB_txn * transaction_a, int version_a)
 {
 	rai::uint256_union version_key (1);
@@ -523,7 +645,13 @@ int rai::block_store::version_get (MDB_txn * transaction_a)
 
 void rai::block_store::do_upgrades (MDB_txn * transaction_a)
 {
-	switch (version_get (transaction_a))
+	auto version_l (version_get (transaction_a));
+	if (version_l < 10)
+	{
+		// Earlier upgrades read and write blocks through the merged table
+		upgrade_block_tables (transaction_a);
+	}
+	switch (version_l)
 	{
 		case 1:
 			upgrade_v1_to_v2 (transaction_a);
@@ -544,6 +672,12 @@ void rai::block_store::do_upgrades (MDB_txn * transaction_a)
 		case 9:
 			upgrade_v9_to_v10 (transaction_a);
 		case 10:
+			upgrade_v10_to_v11 (transaction_a);
+		case 11:
+			upgrade_v11_to_v12 (transaction_a);
+		case 12:
+			upgrade_v12_to_v13 (transaction_a);
+		case 13:
 			break;
 		default:
 			assert (false);
@@ -755,6 +889,8 @@ void rai::block_store::upgrade_v9_to_v10 (MDB_txn * transaction_a)
 {
 	//std::cerr << boost::str (boost::format ("Performing database upgrade to version 10...\n"));
 	version_put (transaction_a, 10);
+	// Version 10 sampled every 32nd block of an account
+	size_t const block_info_max (32);
 	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
 	{
 		rai::account_info info (i->second);
@@ -782,6 +918,67 @@ void rai::block_store::upgrade_v9_to_v10 (MDB_txn * transaction_a)
 	//std::cerr << boost::str (boost::format ("Database upgrade is completed\n"));
 }
 
+void rai::block_store::upgrade_v10_to_v11 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 11);
+	upgrade_block_tables (transaction_a);
+}
+
+void rai::block_store::upgrade_v11_to_v12 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 12);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account account (i->first.uint256 ());
+		rai::account_info info (i->second);
+		// Going from the open block means each balance only walks back to the block indexed just before it
+		auto hash (info.open_block);
+		while (!hash.is_zero ())
+		{
+			block_info_put (transaction_a, hash, rai::block_info (account, block_balance (transaction_a, hash)));
+			hash = block_successor (transaction_a, hash);
+		}
+	}
+}
+
+void rai::block_store::upgrade_v12_to_v13 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 13);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		delegator_put (transaction_a, block_representative (transaction_a, info.rep_block), rai::account (i->first.uint256 ()));
+	}
+}
+
+// Move blocks from the per-type tables in to the type tagged blocks table
+void rai::block_store::upgrade_block_tables (MDB_txn * transaction_a)
+{
+	std::array<std::pair<char const *, rai::block_type>, 4> tables{ { std::make_pair ("send", rai::block_type::send), std::make_pair ("receive", rai::block_type::receive), std::make_pair ("open", rai::block_type::open), std::make_pair ("change", rai::block_type::change) } };
+	for (auto & table : tables)
+	{
+		MDB_dbi database;
+		auto status1 (mdb_dbi_open (transaction_a, table.first, 0, &database));
+		assert (status1 == 0 || status1 == MDB_NOTFOUND);
+		if (status1 == 0)
+		{
+			int64_t count (0);
+			std::vector<uint8_t> data;
+			for (rai::store_iterator i (transaction_a, database), n (nullptr); i != n; ++i)
+			{
+				data.clear ();
+				data.push_back (static_cast<uint8_t> (table.second));
+				data.insert (data.end (), reinterpret_cast<uint8_t const *> (i->second.data ()), reinterpret_cast<uint8_t const *> (i->second.data ()) + i->second.size ());
+				block_put_raw (transaction_a, i->first.uint256 (), rai::mdb_val (data.size (), data.data ()));
+				++count;
+			}
+			block_count_add (table.second, count);
+			auto status2 (mdb_drop (transaction_a, database, 1));
+			assert (status2 == 0);
+		}
+	}
+}
+
 void rai::block_store::clear (MDB_dbi db_a)
 {
 	rai::transaction transaction (environment, nullptr, true);
@@ -807,9 +1004,12 @@ public:
 		rai::block_type type;
 		auto value (store.block_get_raw (transaction, block_a.previous (), type));
 		assert (value.mv_size != 0);
-		std::vector<uint8_t> data (static_cast<uint8_t *> (value.mv_data), static_cast<uint8_t *> (value.mv_data) + value.mv_size);
+		std::vector<uint8_t> data;
+		data.reserve (1 + value.mv_size);
+		data.push_back (static_cast<uint8_t> (type));
+		data.insert (data.end (), static_cast<uint8_t *> (value.mv_data), static_cast<uint8_t *> (value.mv_data) + value.mv_size);
 		std::copy (hash.bytes.begin (), hash.bytes.end (), data.end () - hash.bytes.size ());
-		store.block_put_raw (transaction, store.block_database (type), block_a.previous (), rai::mdb_val (data.size (), data.data ()));
+		store.block_put_raw (transaction, block_a.previous (), rai::mdb_val (data.size (), data.data ()));
 	}
 	void send_block (rai::send_block const & block_a) override
 	{
@@ -832,33 +1032,9 @@ public:
 };
 }
 
-MDB_dbi rai::block_store::block_database (rai::block_type type_a)
+void rai::block_store::block_put_raw (MDB_txn * transaction_a, rai::block_hash const & hash_a, MDB_val value_a)
 {
-	MDB_dbi result;
-	switch (type_a)
-	{
-		case rai::block_type::send:
-			result = send_blocks;
-			break;
-		case rai::block_type::receive:
-			result = receive_blocks;
-			break;
-		case rai::block_type::open:
-			result = open_blocks;
-			break;
-		case rai::block_type::change:
-			result = change_blocks;
-			break;
-		default:
-			assert (false);
-			break;
-	}
-	return result;
-}
-
-void rai::block_store::block_put_raw (MDB_txn * transaction_a, MDB_dbi database_a, rai::block_hash const & hash_a, MDB_val value_a)
-{
-	auto status2 (mdb_put (transaction_a, database_a, rai::mdb_val (hash_a), &value_a, 0));
+	auto status2 (mdb_put (transaction_a, blocks, rai::mdb_val (hash_a), &value_a, 0));
 	assert (status2 == 0);
 }
 
@@ -868,10 +1044,44 @@ void rai::block_store::block_put (MDB_txn * transaction_a, rai::block_hash const
 	std::vector<uint8_t> vector;
 	{
 		rai::vectorstream stream (vector);
+		rai::write (stream, block_a.type ());
 		block_a.serialize (stream);
 		rai::write (stream, successor_a.bytes);
 	}
-	block_put_raw (transaction_a, block_database (block_a.type ()), hash_a, { vector.size (), vector.data () });
+	rai::mdb_val value (vector.size (), vector.data ());
+	auto status (mdb_put (transaction_a, blocks, rai::mdb_val (hash_a), value, MDB_NOOVERWRITE));
+	if (status == MDB_KEYEXIST)
+	{
+		// On collision LMDB points value at the existing entry
+		assert (value.size () != 0);
+		auto existing (static_cast<rai::block_type> (static_cast<uint8_t *> (value.data ())[0]));
+		if (existing != block_a.type ())
+		{
+			block_count_add (existing, -1);
+			block_count_add (block_a.type (), 1);
+		}
+		block_put_raw (transaction_a, hash_a, { vector.size (), vector.data () });
+	}
+	else
+	{
+		assert (status == 0);
+		block_count_add (block_a.type (), 1);
+	}
+	auto filter (std::atomic_load (&block_filter));
+	if (filter != nullptr)
+	{
+		filter->insert (hash_a);
+		auto next (std::atomic_load (&block_filter_next));
+		if (next != nullptr)
+		{
+			next->insert (hash_a);
+		}
+		else if (block_count ().sum () > filter->capacity)
+		{
+			// Past capacity the false positive rate climbs quickly
+			block_filter_grow ();
+		}
+	}
 	set_predecessor predecessor (transaction_a, *this);
 	block_a.visit (predecessor);
 	assert (block_a.previous ().is_zero () || block_successor (transaction_a, block_a.previous ()) == hash_a);
@@ -879,89 +1089,36 @@ void rai::block_store::block_put (MDB_txn * transaction_a, rai::block_hash const
 
 MDB_val rai::block_store::block_get_raw (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::block_type & type_a)
 {
-	rai::mdb_val result;
-	auto status (mdb_get (transaction_a, send_blocks, rai::mdb_val (hash_a), result));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status != 0)
+	MDB_val result{ 0, nullptr };
+	if (block_filter_contains (hash_a))
 	{
-		auto status (mdb_get (transaction_a, receive_blocks, rai::mdb_val (hash_a), result));
+		rai::mdb_val value;
+		auto status (mdb_get (transaction_a, blocks, rai::mdb_val (hash_a), value));
 		assert (status == 0 || status == MDB_NOTFOUND);
-		if (status != 0)
+		if (status == 0)
 		{
-			auto status (mdb_get (transaction_a, open_blocks, rai::mdb_val (hash_a), result));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			if (status != 0)
-			{
-				auto status (mdb_get (transaction_a, change_blocks, rai::mdb_val (hash_a), result));
-				assert (status == 0 || status == MDB_NOTFOUND);
-				if (status == 0)
-				{
-					type_a = rai::block_type::change;
-				}
-			}
-			else
-			{
-				type_a = rai::block_type::open;
-			}
+			assert (value.size () > 1);
+			type_a = static_cast<rai::block_type> (static_cast<uint8_t *> (value.data ())[0]);
+			result.mv_size = value.size () - 1;
+			result.mv_data = static_cast<uint8_t *> (value.data ()) + 1;
 		}
-		else
-		{
-			type_a = rai::block_type::receive;
-		}
-	}
-	else
-	{
-		type_a = rai::block_type::send;
 	}
 	return result;
 }
 
-std::unique_ptr<rai::block> rai::block_store::block_random (MDB_txn * transaction_a, MDB_dbi database)
+std::unique_ptr<rai::block> rai::block_store::block_random (MDB_txn * transaction_a)
 {
 	rai::block_hash hash;
 	rai::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
-	rai::store_iterator existing (transaction_a, database, rai::mdb_val (hash));
+	rai::store_iterator existing (transaction_a, blocks, rai::mdb_val (hash));
 	if (existing == rai::store_iterator (nullptr))
 	{
-		existing = rai::store_iterator (transaction_a, database);
+		existing = rai::store_iterator (transaction_a, blocks);
 	}
 	assert (existing != rai::store_iterator (nullptr));
 	return block_get (transaction_a, rai::block_hash (existing->first.uint256 ()));
 }
 
-std::unique_ptr<rai::block> rai::block_store::block_random (MDB_txn * transaction_a)
-{
-	auto count (block_count (transaction_a));
-	auto region (rai::random_pool.GenerateWord32 (0, count.sum () - 1));
-	std::unique_ptr<rai::block> result;
-	if (region < count.send)
-	{
-		result = block_random (transaction_a, send_blocks);
-	}
-	else
-	{
-		region -= count.send;
-		if (region < count.receive)
-		{
-			result = block_random (transaction_a, receive_blocks);
-		}
-		else
-		{
-			region -= count.receive;
-			if (region < count.open)
-			{
-				result = block_random (transaction_a, open_blocks);
-			}
-			else
-			{
-				// change
-				result = block_random (transaction_a, change_blocks);
-			}
-		}
-	}
-	return result;
-}
-
 rai::block_hash rai::block_store::block_successor (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
 	rai::block_type type;
@@ -1003,73 +1160,168 @@ std::unique_ptr<rai::block> rai::block_store::block_get (MDB_txn * transaction_a
 
 void rai::block_store::block_del (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
-	auto status (mdb_del (transaction_a, send_blocks, rai::mdb_val (hash_a), nullptr));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status != 0)
+	rai::block_type type;
+	auto value (block_get_raw (transaction_a, hash_a, type));
+	assert (value.mv_size != 0);
+	auto status (mdb_del (transaction_a, blocks, rai::mdb_val (hash_a), nullptr));
+	assert (status == 0);
+	block_count_add (type, -1);
+	{
+		std::lock_guard<std::mutex> lock (representative_cache_mutex);
+		representative_cache.get<1> ().erase (hash_a);
+	}
+	// Bits can't be cleared, the stale entry is only a false positive until the next rebuild
+}
+
+bool rai::block_store::block_exists (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+{
+	auto result (block_filter_contains (hash_a));
+	if (result)
 	{
-		auto status (mdb_del (transaction_a, receive_blocks, rai::mdb_val (hash_a), nullptr));
+		rai::mdb_val junk;
+		auto status (mdb_get (transaction_a, blocks, rai::mdb_val (hash_a), junk));
 		assert (status == 0 || status == MDB_NOTFOUND);
-		if (status != 0)
+		result = status == 0;
+	}
+	return result;
+}
+
+rai::block_counts rai::block_store::block_count ()
+{
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	return block_count_cache;
+}
+
+void rai::block_store::block_count_load (MDB_txn * transaction_a)
+{
+	rai::block_counts counts;
+	rai::uint256_union counts_key (2);
+	rai::mdb_val data;
+	auto status (mdb_get (transaction_a, meta, rai::mdb_val (counts_key), data));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == 0)
+	{
+		rai::uint256_union counts_value (data.uint256 ());
+		counts.send = counts_value.qwords[0];
+		counts.receive = counts_value.qwords[1];
+		counts.open = counts_value.qwords[2];
+		counts.change = counts_value.qwords[3];
+	}
+	MDB_stat stat;
+	auto status1 (mdb_stat (transaction_a, blocks, &stat));
+	assert (status1 == 0);
+	if (counts.sum () != stat.ms_entries)
+	{
+		counts = rai::block_counts ();
+		for (rai::store_iterator i (transaction_a, blocks), n (nullptr); i != n; ++i)
 		{
-			auto status (mdb_del (transaction_a, open_blocks, rai::mdb_val (hash_a), nullptr));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			if (status != 0)
+			assert (i->second.size () > 0);
+			switch (static_cast<rai::block_type> (static_cast<uint8_t *> (i->second.data ())[0]))
 			{
-				auto status (mdb_del (transaction_a, change_blocks, rai::mdb_val (hash_a), nullptr));
-				assert (status == 0);
+				case rai::block_type::send:
+					++counts.send;
+					break;
+				case rai::block_type::receive:
+					++counts.receive;
+					break;
+				case rai::block_type::open:
+					++counts.open;
+					break;
+				case rai::block_type::change:
+					++counts.change;
+					break;
+				default:
+					assert (false);
+					break;
 			}
 		}
 	}
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	block_count_cache = counts;
 }
 
-bool rai::block_store::block_exists (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+void rai::block_store::block_count_put (MDB_txn * transaction_a)
 {
-	auto exists (true);
-	rai::mdb_val junk;
-	auto status (mdb_get (transaction_a, send_blocks, rai::mdb_val (hash_a), junk));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	exists = status == 0;
-	if (!exists)
+	auto counts (block_count ());
+	rai::uint256_union counts_key (2);
+	rai::uint256_union counts_value;
+	counts_value.qwords[0] = counts.send;
+	counts_value.qwords[1] = counts.receive;
+	counts_value.qwords[2] = counts.open;
+	counts_value.qwords[3] = counts.change;
+	auto status (mdb_put (transaction_a, meta, rai::mdb_val (counts_key), rai::mdb_val (counts_value), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::block_filter_rebuild (MDB_txn * transaction_a)
+{
+	// Leave room for the ledger to double before the filter has to be rebuilt again
+	auto count (block_count ().sum ());
+	auto filter (std::make_shared<rai::block_filter> (std::max (count * 2, rai::block_filter::capacity_min), block_filter_fp_rate));
+	for (rai::store_iterator i (transaction_a, blocks), n (nullptr); i != n; ++i)
 	{
-		auto status (mdb_get (transaction_a, receive_blocks, rai::mdb_val (hash_a), junk));
-		assert (status == 0 || status == MDB_NOTFOUND);
-		exists = status == 0;
-		if (!exists)
+		filter->insert (i->first.uint256 ());
+	}
+	std::atomic_store (&block_filter, filter);
+}
+
+void rai::block_store::block_filter_grow ()
+{
+	// Leave room for the ledger to double before the filter has to grow again
+	auto next (std::make_shared<rai::block_filter> (std::max (block_count ().sum () * 2, rai::block_filter::capacity_min), block_filter_fp_rate));
+	std::atomic_store (&block_filter_next, next);
+	if (block_filter_thread.joinable ())
+	{
+		// block_filter_next is cleared as the previous fill's last step, so this doesn't wait
+		block_filter_thread.join ();
+	}
+	block_filter_thread = std::thread ([this, next]() {
 		{
-			auto status (mdb_get (transaction_a, open_blocks, rai::mdb_val (hash_a), junk));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			exists = status == 0;
-			if (!exists)
+			// Blocks put earlier in the write transaction that asked for the filter were never inserted into it, wait for that commit so the scan sees them
+			rai::transaction transaction (environment, nullptr, true);
+		}
+		{
+			rai::transaction transaction (environment, nullptr, false);
+			for (rai::store_iterator i (transaction, blocks), n (nullptr); i != n && !block_filter_stopped; ++i)
 			{
-				auto status (mdb_get (transaction_a, change_blocks, rai::mdb_val (hash_a), junk));
-				assert (status == 0 || status == MDB_NOTFOUND);
-				exists = status == 0;
+				next->insert (i->first.uint256 ());
 			}
 		}
-	}
-	return exists;
+		if (!block_filter_stopped)
+		{
+			std::atomic_store (&block_filter, next);
+		}
+		std::atomic_store (&block_filter_next, std::shared_ptr<rai::block_filter> ());
+	});
 }
 
-rai::block_counts rai::block_store::block_count (MDB_txn * transaction_a)
+bool rai::block_store::block_filter_contains (rai::block_hash const & hash_a)
 {
-	rai::block_counts result;
-	MDB_stat send_stats;
-	auto status1 (mdb_stat (transaction_a, send_blocks, &send_stats));
-	assert (status1 == 0);
-	MDB_stat receive_stats;
-	auto status2 (mdb_stat (transaction_a, receive_blocks, &receive_stats));
-	assert (status2 == 0);
-	MDB_stat open_stats;
-	auto status3 (mdb_stat (transaction_a, open_blocks, &open_stats));
-	assert (status3 == 0);
-	MDB_stat change_stats;
-	auto status4 (mdb_stat (transaction_a, change_blocks, &change_stats));
-	assert (status4 == 0);
-	result.send = send_stats.ms_entries;
-	result.receive = receive_stats.ms_entries;
-	result.open = open_stats.ms_entries;
-	result.change = change_stats.ms_entries;
-	return result;
+	auto filter (std::atomic_load (&block_filter));
+	return filter == nullptr || filter->may_contain (hash_a);
+}
+
+void rai::block_store::block_count_add (rai::block_type type_a, int64_t amount_a)
+{
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	switch (type_a)
+	{
+		case rai::block_type::send:
+			block_count_cache.send += amount_a;
+			break;
+		case rai::block_type::receive:
+			block_count_cache.receive += amount_a;
+			break;
+		case rai::block_type::open:
+			block_count_cache.open += amount_a;
+			break;
+		case rai::block_type::change:
+			block_count_cache.change += amount_a;
+			break;
+		default:
+			assert (false);
+			break;
+	}
 }
 
 void rai::block_store::account_del (MDB_txn * transaction_a, rai::account const & account_a)
@@ -1286,6 +1538,24 @@ rai::mdb_val rai::pending_key::val () const
 	return rai::mdb_val (sizeof (*this), const_cast<rai::pending_key *> (this));
 }
 
+rai::delegator_key::delegator_key (rai::account const & representative_a, rai::account const & account_a) :
+representative (representative_a),
+account (account_a)
+{
+}
+
+rai::delegator_key::delegator_key (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (representative) + sizeof (account) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+rai::mdb_val rai::delegator_key::val () const
+{
+	return rai::mdb_val (sizeof (*this), const_cast<rai::delegator_key *> (this));
+}
+
 void rai::block_store::block_info_put (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::block_info const & block_info_a)
 {
 	auto status (mdb_put (transaction_a, blocks_info, rai::mdb_val (hash_a), block_info_a.val (), 0));
@@ -1416,6 +1686,77 @@ void rai::block_store::representation_put (MDB_txn * transaction_a, rai::account
 	rai::uint128_union rep (representation_a);
 	auto status (mdb_put (transaction_a, representation, rai::mdb_val (account_a), rai::mdb_val (rep), 0));
 	assert (status == 0);
+	// Updated ahead of the commit, see representation_cached
+	std::lock_guard<std::mutex> lock (representation_cache_mutex);
+	if (representation_a >= representation_cache_minimum && !representation_a.is_zero ())
+	{
+		representation_cache[account_a] = representation_a;
+	}
+	else
+	{
+		representation_cache.erase (account_a);
+	}
+	auto existing (representation_ordered.find (account_a));
+	if (existing != representation_ordered.end ())
+	{
+		representation_ordered.modify (existing, [&representation_a](rai::representation_entry & entry_a) {
+			entry_a.weight = representation_a;
+		});
+	}
+	else
+	{
+		representation_ordered.insert ({ account_a, representation_a });
+	}
+}
+
+rai::uint128_t rai::block_store::representation_cached (rai::account const & account_a)
+{
+	rai::uint128_t result (0);
+	std::lock_guard<std::mutex> lock (representation_cache_mutex);
+	auto existing (representation_cache.find (account_a));
+	if (existing != representation_cache.end ())
+	{
+		result = existing->second;
+	}
+	return result;
+}
+
+void rai::block_store::representation_cache_load (MDB_txn * transaction_a)
+{
+	std::lock_guard<std::mutex> lock (representation_cache_mutex);
+	representation_cache.clear ();
+	representation_ordered.clear ();
+	for (auto i (representation_begin (transaction_a)), n (representation_end ()); i != n; ++i)
+	{
+		rai::uint128_union weight;
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto error (rai::read (stream, weight));
+		assert (!error);
+		if (weight.number () >= representation_cache_minimum && !weight.is_zero ())
+		{
+			representation_cache[i->first.uint256 ()] = weight.number ();
+		}
+		representation_ordered.insert ({ i->first.uint256 (), weight.number () });
+	}
+}
+
+std::vector<rai::representation_entry> rai::block_store::representation_top (size_t count_a)
+{
+	std::vector<rai::representation_entry> result;
+	std::lock_guard<std::mutex> lock (representation_cache_mutex);
+	auto & weights (representation_ordered.get<1> ());
+	result.reserve (std::min (count_a, weights.size ()));
+	for (auto i (weights.begin ()), n (weights.end ()); i != n && result.size () < count_a; ++i)
+	{
+		result.push_back (*i);
+	}
+	return result;
+}
+
+rai::store_iterator rai::block_store::representation_begin (MDB_txn * transaction_a, rai::account const & account_a)
+{
+	rai::store_iterator result (transaction_a, representation, rai::mdb_val (account_a));
+	return result;
 }
 
 rai::store_iterator rai::block_store::representation_begin (MDB_txn * transaction_a)
@@ -1430,6 +1771,36 @@ rai::store_iterator rai::block_store::representation_end ()
 	return result;
 }
 
+void rai::block_store::delegator_put (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_put (transaction_a, delegators, rai::delegator_key (representative_a, account_a).val (), rai::mdb_val (0, nullptr), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::delegator_del (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_del (transaction_a, delegators, rai::delegator_key (representative_a, account_a).val (), nullptr));
+	assert (status == 0);
+}
+
+rai::store_iterator rai::block_store::delegators_begin (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	rai::store_iterator result (transaction_a, delegators, rai::delegator_key (representative_a, account_a).val ());
+	return result;
+}
+
+rai::store_iterator rai::block_store::delegators_begin (MDB_txn * transaction_a, rai::account const & representative_a)
+{
+	rai::store_iterator result (transaction_a, delegators, rai::delegator_key (representative_a, 0).val ());
+	return result;
+}
+
+rai::store_iterator rai::block_store::delegators_end ()
+{
+	rai::store_iterator result (nullptr);
+	return result;
+}
+
 void rai::block_store::unchecked_clear (MDB_txn * transaction_a)
 {
 	auto status (mdb_drop (transaction_a, unchecked, 0));
@@ -1455,7 +1826,7 @@ std::vector<std::shared_ptr<rai::block>> rai::block_store::unchecked_get (MDB_tx
 	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && rai::block_hash (i->first.uint256 ()) == hash_a; i.next_dup ())
 	{
 		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		result.push_back (rai::deserialize_block (stream));
+		result.push_back (rai::deserialize_block_shared (stream));
 	}
 	return result;
 }
@@ -1497,6 +1868,12 @@ rai::store_iterator rai::block_store::unchecked_begin (MDB_txn * transaction_a,
 	return result;
 }
 
+rai::store_iterator rai::block_store::unchecked_begin (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::mdb_val const & value_a)
+{
+	rai::store_iterator result (transaction_a, unchecked, rai::mdb_val (hash_a), value_a);
+	return result;
+}
+
 rai::store_iterator rai::block_store::unchecked_end ()
 {
 	rai::store_iterator result (nullptr);
@@ -1583,13 +1960,12 @@ void rai::block_store::checksum_del (MDB_txn * transaction_a, uint64_t prefix, u
 	assert (status == 0);
 }
 
-void rai::block_store::flush (MDB_txn * transaction_a)
+std::vector<std::shared_ptr<rai::vote>> rai::block_store::flush (MDB_txn * transaction_a)
 {
-	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> sequence_cache_l;
+	block_count_put (transaction_a);
 	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache_l;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		sequence_cache_l.swap (vote_cache);
 		unchecked_cache_l.swap (unchecked_cache);
 	}
 	for (auto & i : unchecked_cache_l)
@@ -1602,15 +1978,56 @@ void rai::block_store::flush (MDB_txn * transaction_a)
 		auto status (mdb_put (transaction_a, unchecked, rai::mdb_val (i.first), rai::mdb_val (vector.size (), vector.data ()), 0));
 		assert (status == 0);
 	}
-	for (auto i (sequence_cache_l.begin ()), n (sequence_cache_l.end ()); i != n; ++i)
+	std::vector<std::shared_ptr<rai::vote>> result;
+	for (auto & shard : vote_cache)
 	{
-		std::vector<uint8_t> vector;
+		// Copy shards out one at a time so voters on other shards never wait on the writes
+		std::vector<std::shared_ptr<rai::vote>> votes;
 		{
-			rai::vectorstream stream (vector);
-			i->second->serialize (stream);
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			votes.reserve (shard.votes.size ());
+			for (auto & i : shard.votes)
+			{
+				votes.push_back (i.second);
+			}
+		}
+		for (auto & i : votes)
+		{
+			std::vector<uint8_t> vector;
+			{
+				rai::vectorstream stream (vector);
+				i->serialize (stream);
+			}
+			auto status1 (mdb_put (transaction_a, vote, rai::mdb_val (i->account), rai::mdb_val (vector.size (), vector.data ()), 0));
+			assert (status1 == 0);
+		}
+		result.insert (result.end (), votes.begin (), votes.end ());
+	}
+	return result;
+}
+
+void rai::block_store::flush ()
+{
+	std::vector<std::shared_ptr<rai::vote>> written;
+	{
+		rai::transaction transaction (environment, nullptr, true);
+		written = flush (transaction);
+	}
+	flushed (written);
+}
+
+void rai::block_store::flushed (std::vector<std::shared_ptr<rai::vote>> const & votes_a)
+{
+	for (auto & i : votes_a)
+	{
+		auto & shard (vote_shard (i->account));
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		auto existing (shard.votes.find (i->account));
+		// Votes replaced since they were written still have to be flushed next time
+		if (existing != shard.votes.end () && existing->second == i)
+		{
+			shard.votes.erase (existing);
 		}
-		auto status1 (mdb_put (transaction_a, vote, rai::mdb_val (i->first), rai::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status1 == 0);
 	}
 }
 
@@ -1638,46 +2055,71 @@ std::shared_ptr<rai::vote> rai::block_store::vote_get (MDB_txn * transaction_a,
 	return result;
 }
 
+rai::vote_cache_shard & rai::block_store::vote_shard (rai::account const & account_a)
+{
+	// Accounts are public keys so their low bits are already evenly spread
+	return vote_cache[account_a.bytes[0] % vote_cache.size ()];
+}
+
 std::shared_ptr<rai::vote> rai::block_store::vote_current (MDB_txn * transaction_a, rai::account const & account_a)
 {
-	assert (!cache_mutex.try_lock ());
 	std::shared_ptr<rai::vote> result;
-	auto existing (vote_cache.find (account_a));
-	if (existing != vote_cache.end ())
+	auto & shard (vote_shard (account_a));
 	{
-		result = existing->second;
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		auto existing (shard.votes.find (account_a));
+		if (existing != shard.votes.end ())
+		{
+			result = existing->second;
+		}
 	}
-	else
+	if (result == nullptr)
 	{
 		result = vote_get (transaction_a, account_a);
 	}
 	return result;
 }
 
-std::shared_ptr<rai::vote> rai::block_store::vote_generate (MDB_txn * transaction_a, rai::account const & account_a, rai::raw_key const & key_a, std::shared_ptr<rai::block> block_a)
+std::shared_ptr<rai::vote> rai::block_store::vote_update (MDB_txn * transaction_a, rai::account const & account_a, std::function<std::shared_ptr<rai::vote> (std::shared_ptr<rai::vote> const &)> const & action_a)
 {
-	std::lock_guard<std::mutex> lock (cache_mutex);
-	auto result (vote_current (transaction_a, account_a));
-	uint64_t sequence ((result ? result->sequence : 0) + 1);
-	result = std::make_shared<rai::vote> (account_a, key_a, sequence, block_a);
-	vote_cache[account_a] = result;
+	auto & shard (vote_shard (account_a));
+	std::shared_ptr<rai::vote> stored;
+	std::unique_lock<std::mutex> lock (shard.mutex);
+	auto existing (shard.votes.find (account_a));
+	if (existing == shard.votes.end ())
+	{
+		lock.unlock ();
+		stored = vote_get (transaction_a, account_a);
+		lock.lock ();
+		// Another thread may have cached a vote while we were reading
+		existing = shard.votes.find (account_a);
+	}
+	auto result (action_a (existing != shard.votes.end () ? existing->second : stored));
+	shard.votes[account_a] = result;
 	return result;
 }
 
+std::shared_ptr<rai::vote> rai::block_store::vote_generate (MDB_txn * transaction_a, rai::account const & account_a, rai::raw_key const & key_a, std::shared_ptr<rai::block> block_a)
+{
+	return vote_update (transaction_a, account_a, [&account_a, &key_a, &block_a](std::shared_ptr<rai::vote> const & current_a) -> std::shared_ptr<rai::vote> {
+		uint64_t sequence ((current_a ? current_a->sequence : 0) + 1);
+		return std::make_shared<rai::vote> (account_a, key_a, sequence, block_a);
+	});
+}
+
 std::shared_ptr<rai::vote> rai::block_store::vote_max (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a)
 {
-	std::lock_guard<std::mutex> lock (cache_mutex);
-	auto current (vote_current (transaction_a, vote_a->account));
-	auto result (vote_a);
-	if (current != nullptr)
-	{
-		if (current->sequence > result->sequence)
+	return vote_update (transaction_a, vote_a->account, [&vote_a](std::shared_ptr<rai::vote> const & current_a) -> std::shared_ptr<rai::vote> {
+		auto result (vote_a);
+		if (current_a != nullptr)
 		{
-			result = current;
+			if (current_a->sequence > result->sequence)
+			{
+				result = current_a;
+			}
 		}
-	}
-	vote_cache[vote_a->account] = result;
-	return result;
+		return result;
+	});
 }
 
 rai::vote_result rai::block_store::vote_validate (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a)
@@ -1686,12 +2128,18 @@ rai::vote_result rai::block_store::vote_validate (MDB_txn * transaction_a, std::
 	// Reject unsigned votes
 	if (!rai::validate_message (vote_a->account, vote_a->hash (), vote_a->signature))
 	{
-		result.code = rai::vote_code::replay;
-		result.vote = vote_max (transaction_a, vote_a); // Make sure this sequence number is > any we've seen from this account before
-		if (result.vote == vote_a)
-		{
-			result.code = rai::vote_code::vote;
-		}
+		result = vote_validate_sequence (transaction_a, vote_a);
+	}
+	return result;
+}
+
+rai::vote_result rai::block_store::vote_validate_sequence (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a)
+{
+	rai::vote_result result ({ rai::vote_code::replay, 0 });
+	result.vote = vote_max (transaction_a, vote_a); // Make sure this sequence number is > any we've seen from this account before
+	if (result.vote == vote_a)
+	{
+		result.code = rai::vote_code::vote;
 	}
 	return result;
 }
@@ -1791,14 +2239,17 @@ namespace
 class ledger_processor : public rai::block_visitor
 {
 public:
-	ledger_processor (rai::ledger &, MDB_txn *);
+	ledger_processor (rai::ledger &, MDB_txn *, rai::account const &);
 	virtual ~ledger_processor () = default;
 	void send_block (rai::send_block const &) override;
 	void receive_block (rai::receive_block const &) override;
 	void open_block (rai::open_block const &) override;
 	void change_block (rai::change_block const &) override;
+	bool validate_signature (rai::account const &, rai::block_hash const &, rai::signature const &);
 	rai::ledger & ledger;
 	MDB_txn * transaction;
+	// Account the block signature was verified against before processing, zero if it wasn't
+	rai::account verified;
 	rai::process_return result;
 };
 
@@ -1894,8 +2345,6 @@ void balance_visitor::send_block (rai::send_block const & block_a)
 
 void balance_visitor::receive_block (rai::receive_block const & block_a)
 {
-	amount_visitor source (transaction, store);
-	source.compute (block_a.hashables.source);
 	rai::block_info block_info;
 	if (!store.block_info_get (transaction, block_a.hash (), block_info))
 	{
@@ -1904,6 +2353,8 @@ void balance_visitor::receive_block (rai::receive_block const & block_a)
 	}
 	else
 	{
+		amount_visitor source (transaction, store);
+		source.compute (block_a.hashables.source);
 		result += source.result;
 		current = block_a.hashables.previous;
 	}
@@ -1911,9 +2362,17 @@ void balance_visitor::receive_block (rai::receive_block const & block_a)
 
 void balance_visitor::open_block (rai::open_block const & block_a)
 {
-	amount_visitor source (transaction, store);
-	source.compute (block_a.hashables.source);
-	result += source.result;
+	rai::block_info block_info;
+	if (!store.block_info_get (transaction, block_a.hash (), block_info))
+	{
+		result += block_info.balance.number ();
+	}
+	else
+	{
+		amount_visitor source (transaction, store);
+		source.compute (block_a.hashables.source);
+		result += source.result;
+	}
 	current = 0;
 }
 
@@ -1960,31 +2419,26 @@ public:
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, pending.source);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
-		if (!(info.block_count % ledger.store.block_info_max))
-		{
-			ledger.store.block_info_del (transaction, hash);
-		}
+		ledger.store.block_info_del (transaction, hash);
 	}
 	void receive_block (rai::receive_block const & block_a) override
 	{
 		auto hash (block_a.hash ());
-		auto representative (ledger.representative (transaction, block_a.hashables.previous));
+		// Receiving doesn't change the representative so previous shares the rep block of our head
+		auto representative (ledger.representative (transaction, hash));
 		auto amount (ledger.amount (transaction, block_a.hashables.source));
 		auto destination_account (ledger.account (transaction, hash));
 		rai::account_info info;
 		auto error (ledger.store.account_get (transaction, destination_account, info));
 		assert (!error);
-		ledger.store.representation_add (transaction, ledger.representative (transaction, hash), 0 - amount);
+		ledger.store.representation_add (transaction, representative, 0 - amount);
 		ledger.change_latest (transaction, destination_account, block_a.hashables.previous, representative, ledger.balance (transaction, block_a.hashables.previous), info.block_count - 1);
 		ledger.store.block_del (transaction, hash);
 		ledger.store.pending_put (transaction, rai::pending_key (destination_account, block_a.hashables.source), { ledger.account (transaction, block_a.hashables.source), amount });
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, destination_account);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
-		if (!(info.block_count % ledger.store.block_info_max))
-		{
-			ledger.store.block_info_del (transaction, hash);
-		}
+		ledger.store.block_info_del (transaction, hash);
 	}
 	void open_block (rai::open_block const & block_a) override
 	{
@@ -1996,6 +2450,7 @@ public:
 		ledger.store.block_del (transaction, hash);
 		ledger.store.pending_put (transaction, rai::pending_key (destination_account, block_a.hashables.source), { ledger.account (transaction, block_a.hashables.source), amount });
 		ledger.store.frontier_del (transaction, hash);
+		ledger.store.block_info_del (transaction, hash);
 	}
 	void change_block (rai::change_block const & block_a) override
 	{
@@ -2008,15 +2463,13 @@ public:
 		auto balance (ledger.balance (transaction, block_a.hashables.previous));
 		ledger.store.representation_add (transaction, representative, balance);
 		ledger.store.representation_add (transaction, hash, 0 - balance);
-		ledger.store.block_del (transaction, hash);
+		// The change block is still needed to find the representative the account is leaving
 		ledger.change_latest (transaction, account, block_a.hashables.previous, representative, info.balance, info.block_count - 1);
+		ledger.store.block_del (transaction, hash);
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, account);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
-		if (!(info.block_count % ledger.store.block_info_max))
-		{
-			ledger.store.block_info_del (transaction, hash);
-		}
+		ledger.store.block_info_del (transaction, hash);
 	}
 	MDB_txn * transaction;
 	rai::ledger & ledger;
@@ -2097,7 +2550,12 @@ rai::uint128_t rai::ledger::account_pending (MDB_txn * transaction_a, rai::accou
 
 rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a)
 {
-	ledger_processor processor (*this, transaction_a);
+	return process (transaction_a, block_a, rai::account (0));
+}
+
+rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a, rai::account const & verified_a)
+{
+	ledger_processor processor (*this, transaction_a, verified_a);
 	block_a.visit (processor);
 	return processor.result;
 }
@@ -2114,7 +2572,21 @@ rai::uint128_t rai::ledger::supply (MDB_txn * transaction_a)
 
 rai::block_hash rai::ledger::representative (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
-	auto result (representative_calculated (transaction_a, hash_a));
+	rai::block_hash result (0);
+	// An account's head is covered by its current rep block, only walk the chain for older blocks
+	rai::block_info block_info;
+	if (!store.block_info_get (transaction_a, hash_a, block_info))
+	{
+		rai::account_info info;
+		if (!store.account_get (transaction_a, block_info.account, info) && info.head == hash_a)
+		{
+			result = info.rep_block;
+		}
+	}
+	if (result.is_zero ())
+	{
+		result = representative_calculated (transaction_a, hash_a);
+	}
 	assert (result.is_zero () || store.block_exists (transaction_a, result));
 	return result;
 }
@@ -2156,6 +2628,11 @@ rai::uint128_t rai::ledger::weight (MDB_txn * transaction_a, rai::account const
 	return store.representation_get (transaction_a, account_a);
 }
 
+rai::uint128_t rai::ledger::weight (rai::account const & account_a)
+{
+	return store.representation_cached (account_a);
+}
+
 // Rollback blocks until `block_a' doesn't exist
 void rai::ledger::rollback (MDB_txn * transaction_a, rai::block_hash const & block_a)
 {
@@ -2177,8 +2654,9 @@ rai::account rai::ledger::account (MDB_txn * transaction_a, rai::block_hash cons
 {
 	assert (store.block_exists (transaction_a, hash_a));
 	auto hash (hash_a);
-	rai::block_hash successor (1);
+	rai::block_hash successor (hash_a);
 	rai::block_info block_info;
+	// Every block is indexed once its account is updated, only walk forward for a block still being inserted
 	while (!successor.is_zero () && store.block_info_get (transaction_a, successor, block_info))
 	{
 		successor = store.block_successor (transaction_a, hash);
@@ -2210,14 +2688,39 @@ rai::uint128_t rai::ledger::amount (MDB_txn * transaction_a, rai::block_hash con
 
 void rai::block_store::representation_add (MDB_txn * transaction_a, rai::block_hash const & source_a, rai::uint128_t const & amount_a)
 {
-	auto source_block (block_get (transaction_a, source_a));
-	assert (source_block != nullptr);
-	auto source_rep (source_block->representative ());
+	auto source_rep (block_representative (transaction_a, source_a));
 	assert (!source_rep.is_zero ());
 	auto source_previous (representation_get (transaction_a, source_rep));
 	representation_put (transaction_a, source_rep, source_previous + amount_a);
 }
 
+rai::account rai::block_store::block_representative (MDB_txn * transaction_a, rai::block_hash const & rep_block_a)
+{
+	rai::account result (0);
+	{
+		std::lock_guard<std::mutex> lock (representative_cache_mutex);
+		auto existing (representative_cache.get<1> ().find (rep_block_a));
+		if (existing != representative_cache.get<1> ().end ())
+		{
+			result = existing->representative;
+			representative_cache.relocate (representative_cache.begin (), representative_cache.project<0> (existing));
+		}
+	}
+	if (result.is_zero ())
+	{
+		auto block (block_get (transaction_a, rep_block_a));
+		assert (block != nullptr);
+		result = block->representative ();
+		std::lock_guard<std::mutex> lock (representative_cache_mutex);
+		representative_cache.push_front ({ rep_block_a, result });
+		if (representative_cache.size () > representative_cache_max)
+		{
+			representative_cache.pop_back ();
+		}
+	}
+	return result;
+}
+
 // Return latest block for account
 rai::block_hash rai::ledger::latest (MDB_txn * transaction_a, rai::account const & account_a)
 {
@@ -2288,23 +2791,36 @@ void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & a
 	}
 	if (!hash_a.is_zero ())
 	{
+		// Only open and change blocks, and their rollbacks, move an account between representatives
+		if (!exists || info.rep_block != rep_block_a)
+		{
+			auto representative (store.block_representative (transaction_a, rep_block_a));
+			if (exists)
+			{
+				auto previous (store.block_representative (transaction_a, info.rep_block));
+				if (previous != representative)
+				{
+					store.delegator_del (transaction_a, previous, account_a);
+					store.delegator_put (transaction_a, representative, account_a);
+				}
+			}
+			else
+			{
+				store.delegator_put (transaction_a, representative, account_a);
+			}
+		}
 		info.head = hash_a;
 		info.rep_block = rep_block_a;
 		info.balance = balance_a;
 		info.modified = rai::seconds_since_epoch ();
 		info.block_count = block_count_a;
 		store.account_put (transaction_a, account_a, info);
-		if (!(block_count_a % store.block_info_max))
-		{
-			rai::block_info block_info;
-			block_info.account = account_a;
-			block_info.balance = balance_a;
-			store.block_info_put (transaction_a, hash_a, block_info);
-		}
+		store.block_info_put (transaction_a, hash_a, rai::block_info (account_a, balance_a));
 		checksum_update (transaction_a, hash_a);
 	}
 	else
 	{
+		store.delegator_del (transaction_a, store.block_representative (transaction_a, info.rep_block), account_a);
 		store.account_del (transaction_a, account_a);
 	}
 }
@@ -2367,7 +2883,7 @@ void ledger_processor::change_block (rai::change_block const & block_a)
 				auto latest_error (ledger.store.account_get (transaction, account, info));
 				assert (!latest_error);
 				assert (info.head == block_a.hashables.previous);
-				result.code = validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
+				result.code = validate_signature (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
 				if (result.code == rai::process_result::progress)
 				{
 					ledger.store.block_put (transaction, hash, block_a);
@@ -2400,7 +2916,7 @@ void ledger_processor::send_block (rai::send_block const & block_a)
 			result.code = account.is_zero () ? rai::process_result::fork : rai::process_result::progress;
 			if (result.code == rai::process_result::progress)
 			{
-				result.code = validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
+				result.code = validate_signature (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
 				if (result.code == rai::process_result::progress)
 				{
 					rai::account_info info;
@@ -2441,7 +2957,7 @@ void ledger_processor::receive_block (rai::receive_block const & block_a)
 			result.code = account.is_zero () ? rai::process_result::gap_previous : rai::process_result::progress; //Have we seen the previous block? No entries for account at all (Harmless)
 			if (result.code == rai::process_result::progress)
 			{
-				result.code = rai::validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
+				result.code = validate_signature (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
 				if (result.code == rai::process_result::progress)
 				{
 					rai::account_info info;
@@ -2489,7 +3005,7 @@ void ledger_processor::open_block (rai::open_block const & block_a)
 		result.code = source_missing ? rai::process_result::gap_source : rai::process_result::progress; // Have we seen the source block? (Harmless)
 		if (result.code == rai::process_result::progress)
 		{
-			result.code = rai::validate_message (block_a.hashables.account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
+			result.code = validate_signature (block_a.hashables.account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
 			if (result.code == rai::process_result::progress)
 			{
 				rai::account_info info;
@@ -2522,12 +3038,24 @@ void ledger_processor::open_block (rai::open_block const & block_a)
 	}
 }
 
-ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a) :
+ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a, rai::account const & verified_a) :
 ledger (ledger_a),
-transaction (transaction_a)
+transaction (transaction_a),
+verified (verified_a)
 {
 }
 
+bool ledger_processor::validate_signature (rai::account const & account_a, rai::block_hash const & hash_a, rai::signature const & signature_a)
+{
+	// Skip curve math if the signature was already checked against this exact account
+	auto result (verified.is_zero () || verified != account_a);
+	if (result)
+	{
+		result = rai::validate_message (account_a, hash_a, signature_a);
+	}
+	return result;
+}
+
 rai::vote::vote (rai::vote const & other_a) :
 sequence (other_a.sequence),
 block (other_a.block),
@@ -2549,7 +3077,7 @@ rai::vote::vote (bool & error_a, rai::stream & stream_a)
 				error_a = rai::read (stream_a, sequence);
 				if (!error_a)
 				{
-					block = rai::deserialize_block (stream_a);
+					block = rai::deserialize_block_shared (stream_a);
 					error_a = block == nullptr;
 				}
 			}
@@ -2570,7 +3098,7 @@ rai::vote::vote (bool & error_a, rai::stream & stream_a, rai::block_type type_a)
 				error_a = rai::read (stream_a, sequence);
 				if (!error_a)
 				{
-					block = rai::deserialize_block (stream_a, type_a);
+					block = rai::deserialize_block_shared (stream_a, type_a);
 					error_a = block == nullptr;
 				}
 			}
@@ -2648,7 +3176,9 @@ void rai::genesis::initialize (MDB_txn * transaction_a, rai::block_store & store
 	assert (store_a.latest_begin (transaction_a) == store_a.latest_end ());
 	store_a.block_put (transaction_a, hash_l, *open);
 	store_a.account_put (transaction_a, genesis_account, { hash_l, open->hash (), open->hash (), std::numeric_limits<rai::uint128_t>::max (), rai::seconds_since_epoch (), 1 });
+	store_a.block_info_put (transaction_a, hash_l, rai::block_info (genesis_account, std::numeric_limits<rai::uint128_t>::max ()));
 	store_a.representation_put (transaction_a, genesis_account, std::numeric_limits<rai::uint128_t>::max ());
+	store_a.delegator_put (transaction_a, genesis_account, genesis_account);
 	store_a.checksum_put (transaction_a, 0, 0, hash_l);
 	store_a.frontier_put (transaction_a, hash_l, genesis_account);
 }
@@ -3,8 +3,15 @@
 #include <rai/lib/blocks.hpp>
 #include <rai/node/utility.hpp>
 
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <thread>
 #include <unordered_map>
 
 #include <blake2/blake2.h>
@@ -74,6 +81,8 @@ public:
 	store_iterator (MDB_txn *, MDB_dbi);
 	store_iterator (std::nullptr_t);
 	store_iterator (MDB_txn *, MDB_dbi, MDB_val const &);
+	// Positions a duplicate sorted table on the first value under key not less than value, or on the next key if there is none
+	store_iterator (MDB_txn *, MDB_dbi, MDB_val const &, MDB_val const &);
 	store_iterator (rai::store_iterator &&);
 	store_iterator (rai::store_iterator const &) = delete;
 	~store_iterator ();
@@ -113,6 +122,15 @@ public:
 	rai::account account;
 	rai::block_hash hash;
 };
+class delegator_key
+{
+public:
+	delegator_key (rai::account const &, rai::account const &);
+	delegator_key (MDB_val const &);
+	rai::mdb_val val () const;
+	rai::account representative;
+	rai::account account;
+};
 class block_info
 {
 public:
@@ -171,23 +189,79 @@ public:
 	rai::vote_code code;
 	std::shared_ptr<rai::vote> vote;
 };
+class representative_entry
+{
+public:
+	rai::block_hash rep_block;
+	rai::account representative;
+};
+class representation_entry
+{
+public:
+	rai::account representative;
+	rai::uint128_t weight;
+};
+// Lock-free Bloom filter over block hashes, may report false positives but never false negatives
+class block_filter
+{
+public:
+	block_filter (size_t, double);
+	void insert (rai::block_hash const &);
+	// Returns false if the hash was definitely never inserted
+	bool may_contain (rai::block_hash const &) const;
+	// Number of hashes the filter was sized for at its false positive rate
+	size_t capacity;
+	size_t bits;
+	unsigned hashes;
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+	static size_t const capacity_min = 1024 * 1024;
+};
+class vote_cache_shard
+{
+public:
+	std::mutex mutex;
+	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> votes;
+};
 class block_store
 {
 public:
-	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128);
+	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128, double block_filter_fp_rate = 0.01);
+	~block_store ();
 
-	MDB_dbi block_database (rai::block_type);
-	void block_put_raw (MDB_txn *, MDB_dbi, rai::block_hash const &, MDB_val);
+	// Value must already carry the block type prefix
+	void block_put_raw (MDB_txn *, rai::block_hash const &, MDB_val);
 	void block_put (MDB_txn *, rai::block_hash const &, rai::block const &, rai::block_hash const & = rai::block_hash (0));
+	// Returns the block and successor bytes following the type prefix
 	MDB_val block_get_raw (MDB_txn *, rai::block_hash const &, rai::block_type &);
 	rai::block_hash block_successor (MDB_txn *, rai::block_hash const &);
 	void block_successor_clear (MDB_txn *, rai::block_hash const &);
 	std::unique_ptr<rai::block> block_get (MDB_txn *, rai::block_hash const &);
 	std::unique_ptr<rai::block> block_random (MDB_txn *);
-	std::unique_ptr<rai::block> block_random (MDB_txn *, MDB_dbi);
 	void block_del (MDB_txn *, rai::block_hash const &);
 	bool block_exists (MDB_txn *, rai::block_hash const &);
-	rai::block_counts block_count (MDB_txn *);
+	rai::block_counts block_count ();
+	// Per-type counts are kept in memory and written to the meta table once per block_processor batch and by flush, so block_put and block_del don't rewrite the same meta page for every block
+	// Like representation_cache they're updated inside the write transaction and can be seen shortly before the commit
+	void block_count_add (rai::block_type, int64_t);
+	// Blocks committed after the last write, for instance before a crash, show up as a total that doesn't match the blocks table and are recounted
+	void block_count_load (MDB_txn *);
+	void block_count_put (MDB_txn *);
+	std::mutex block_count_mutex;
+	rai::block_counts block_count_cache;
+	// Size the filter for the current ledger and fill it from the blocks table
+	void block_filter_rebuild (MDB_txn *);
+	// Publish a larger block_filter_next and fill it from the blocks table on block_filter_thread, off the write path
+	void block_filter_grow ();
+	// Returns false if the block is definitely not in the store, true while there's no filter yet
+	bool block_filter_contains (rai::block_hash const &);
+	// Built when the store opens and replaced by one twice as large when the ledger grows past its capacity
+	// Replaced with std::atomic_store so readers finish on the filter they loaded
+	std::shared_ptr<rai::block_filter> block_filter;
+	// The larger filter while it's being filled, block_put inserts into both until it replaces block_filter
+	std::shared_ptr<rai::block_filter> block_filter_next;
+	std::thread block_filter_thread;
+	std::atomic<bool> block_filter_stopped;
+	double block_filter_fp_rate;
 
 	void frontier_put (MDB_txn *, rai::block_hash const &, rai::account const &);
 	rai::account frontier_get (MDB_txn *, rai::block_hash const &);
@@ -218,20 +292,61 @@ public:
 	rai::store_iterator block_info_begin (MDB_txn *);
 	rai::store_iterator block_info_end ();
 	rai::uint128_t block_balance (MDB_txn *, rai::block_hash const &);
-	static size_t const block_info_max = 32;
 
 	rai::uint128_t representation_get (MDB_txn *, rai::account const &);
 	void representation_put (MDB_txn *, rai::account const &, rai::uint128_t const &);
 	void representation_add (MDB_txn *, rai::account const &, rai::uint128_t const &);
+	// Representative named by a rep block, served from an LRU so balance changes don't deserialize the block
+	rai::account block_representative (MDB_txn *, rai::block_hash const &);
+	std::mutex representative_cache_mutex;
+	boost::multi_index_container<
+	rai::representative_entry,
+	boost::multi_index::indexed_by<
+	boost::multi_index::sequenced<>,
+	boost::multi_index::hashed_unique<boost::multi_index::member<rai::representative_entry, rai::block_hash, &rai::representative_entry::rep_block>>>>
+	representative_cache;
+	static size_t const representative_cache_max = 64 * 1024;
+	// Weight of a representative without a transaction, zero for representatives under representation_cache_minimum
+	// The cache is updated by representation_put inside the write transaction, so readers can see a weight shortly before it's committed. This is accepted: rai::transaction always commits, so the cache never holds a weight the table won't
+	rai::uint128_t representation_cached (rai::account const &);
+	void representation_cache_load (MDB_txn *);
+	std::mutex representation_cache_mutex;
+	std::unordered_map<rai::account, rai::uint128_t> representation_cache;
+	rai::uint128_t representation_cache_minimum;
+	// The heaviest representatives first, at most count of them
+	std::vector<rai::representation_entry> representation_top (size_t);
+	// Every row of the representation table ordered heaviest first and then by account, including representatives whose weight dropped to zero, guarded by representation_cache_mutex
+	// Like representation_cache it's updated inside the write transaction and can be seen shortly before the commit
+	boost::multi_index_container<
+	rai::representation_entry,
+	boost::multi_index::indexed_by<
+	boost::multi_index::hashed_unique<boost::multi_index::member<rai::representation_entry, rai::account, &rai::representation_entry::representative>>,
+	boost::multi_index::ordered_unique<
+	boost::multi_index::composite_key<
+	rai::representation_entry,
+	boost::multi_index::member<rai::representation_entry, rai::uint128_t, &rai::representation_entry::weight>,
+	boost::multi_index::member<rai::representation_entry, rai::account, &rai::representation_entry::representative>>,
+	boost::multi_index::composite_key_compare<std::greater<rai::uint128_t>, std::less<rai::account>>>>>
+	representation_ordered;
+	rai::store_iterator representation_begin (MDB_txn *, rai::account const &);
 	rai::store_iterator representation_begin (MDB_txn *);
 	rai::store_iterator representation_end ();
 
+	// Maintained by ledger::change_latest so delegators of a representative can be listed without a ledger scan
+	void delegator_put (MDB_txn *, rai::account const &, rai::account const &);
+	void delegator_del (MDB_txn *, rai::account const &, rai::account const &);
+	rai::store_iterator delegators_begin (MDB_txn *, rai::account const &, rai::account const &);
+	rai::store_iterator delegators_begin (MDB_txn *, rai::account const &);
+	rai::store_iterator delegators_end ();
+
 	void unchecked_clear (MDB_txn *);
 	void unchecked_put (MDB_txn *, rai::block_hash const &, std::shared_ptr<rai::block> const &);
 	std::vector<std::shared_ptr<rai::block>> unchecked_get (MDB_txn *, rai::block_hash const &);
 	void unchecked_del (MDB_txn *, rai::block_hash const &, rai::block const &);
 	rai::store_iterator unchecked_begin (MDB_txn *);
 	rai::store_iterator unchecked_begin (MDB_txn *, rai::block_hash const &);
+	// Resume at a serialized block under hash, or wherever it would sort if it's gone
+	rai::store_iterator unchecked_begin (MDB_txn *, rai::block_hash const &, rai::mdb_val const &);
 	rai::store_iterator unchecked_end ();
 	size_t unchecked_count (MDB_txn *);
 	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache;
@@ -248,6 +363,8 @@ public:
 	void checksum_del (MDB_txn *, uint64_t, uint8_t);
 
 	rai::vote_result vote_validate (MDB_txn *, std::shared_ptr<rai::vote>);
+	// Check a vote with an already verified signature against the highest sequence number seen
+	rai::vote_result vote_validate_sequence (MDB_txn *, std::shared_ptr<rai::vote>);
 	// Return latest vote for an account from store
 	std::shared_ptr<rai::vote> vote_get (MDB_txn *, rai::account const &);
 	// Populate vote with the next sequence number
@@ -256,11 +373,22 @@ public:
 	std::shared_ptr<rai::vote> vote_max (MDB_txn *, std::shared_ptr<rai::vote>);
 	// Return latest vote for an account considering the vote cache
 	std::shared_ptr<rai::vote> vote_current (MDB_txn *, rai::account const &);
-	void flush (MDB_txn *);
+	// Replace the latest vote for an account with the result of action, store reads happen outside the shard lock
+	std::shared_ptr<rai::vote> vote_update (MDB_txn *, rai::account const &, std::function<std::shared_ptr<rai::vote> (std::shared_ptr<rai::vote> const &)> const &);
+	rai::vote_cache_shard & vote_shard (rai::account const &);
+	// Writes the block counts and cached unchecked blocks and votes, returning the votes written
+	// Votes stay in vote_cache so readers don't fall back to an older sequence in the table before the write is committed
+	std::vector<std::shared_ptr<rai::vote>> flush (MDB_txn *);
+	// Flushes in a short write transaction of its own and drops the written votes from vote_cache once it's committed
+	void flush ();
+	// Drops votes returned by flush (MDB_txn *) from vote_cache, call once their transaction has committed
+	void flushed (std::vector<std::shared_ptr<rai::vote>> const &);
 	rai::store_iterator vote_begin (MDB_txn *);
 	rai::store_iterator vote_end ();
+	// Guards unchecked_cache
 	std::mutex cache_mutex;
-	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> vote_cache;
+	// Latest votes not yet flushed, sharded by account so voters don't contend on one mutex
+	std::array<rai::vote_cache_shard, 16> vote_cache;
 
 	void version_put (MDB_txn *, int);
 	int version_get (MDB_txn *);
@@ -274,6 +402,10 @@ public:
 	void upgrade_v7_to_v8 (MDB_txn *);
 	void upgrade_v8_to_v9 (MDB_txn *);
 	void upgrade_v9_to_v10 (MDB_txn *);
+	void upgrade_v10_to_v11 (MDB_txn *);
+	void upgrade_v11_to_v12 (MDB_txn *);
+	void upgrade_v12_to_v13 (MDB_txn *);
+	void upgrade_block_tables (MDB_txn *);
 
 	void clear (MDB_dbi);
 
@@ -282,20 +414,16 @@ public:
 	MDB_dbi frontiers;
 	// account -> block_hash, representative, balance, timestamp    // Account to head block, representative, balance, last_change
 	MDB_dbi accounts;
-	// block_hash -> send_block
-	MDB_dbi send_blocks;
-	// block_hash -> receive_block
-	MDB_dbi receive_blocks;
-	// block_hash -> open_block
-	MDB_dbi open_blocks;
-	// block_hash -> change_block
-	MDB_dbi change_blocks;
+	// block_hash -> block_type, block, successor                   // All blocks, tagged with their type
+	MDB_dbi blocks;
 	// block_hash -> sender, amount, destination                    // Pending blocks to sender account, amount, destination account
 	MDB_dbi pending;
-	// block_hash -> account, balance                               // Blocks info
+	// block_hash -> account, balance                               // Account and balance for every block
 	MDB_dbi blocks_info;
 	// account -> weight                                            // Representation
 	MDB_dbi representation;
+	// (account, account) ->                                        // Representative to the accounts delegating to it
+	MDB_dbi delegators;
 	// block_hash -> block                                          // Unchecked bootstrap blocks
 	MDB_dbi unchecked;
 	// block_hash ->                                                // Blocks that haven't been broadcast
@@ -339,11 +467,22 @@ class votes
 {
 public:
 	votes (std::shared_ptr<rai::block>);
-	rai::tally_result vote (std::shared_ptr<rai::vote>);
+	// Count a vote from a representative with the given weight
+	rai::tally_result vote (std::shared_ptr<rai::vote>, rai::uint128_t const &);
+	// Block with the greatest running total and its total
+	std::pair<rai::uint128_t, std::shared_ptr<rai::block>> winner () const;
 	// Root block of fork
 	rai::block_hash id;
 	// All votes received by account
 	std::unordered_map<rai::account, std::shared_ptr<rai::block>> rep_votes;
+	// Weight each account's vote was counted with
+	std::unordered_map<rai::account, rai::uint128_t> rep_weights;
+	// Running weight total and number of votes for each block voted on
+	std::unordered_map<std::shared_ptr<rai::block>, std::pair<rai::uint128_t, size_t>, rai::shared_ptr_block_hash, rai::shared_ptr_block_hash> totals;
+
+private:
+	void add (std::shared_ptr<rai::block>, rai::uint128_t const &);
+	void remove (std::shared_ptr<rai::block>, rai::uint128_t const &);
 };
 class ledger
 {
@@ -358,6 +497,8 @@ public:
 	rai::uint128_t account_balance (MDB_txn *, rai::account const &);
 	rai::uint128_t account_pending (MDB_txn *, rai::account const &);
 	rai::uint128_t weight (MDB_txn *, rai::account const &);
+	// In-memory weight used for vote tallying, dust representatives count as zero
+	rai::uint128_t weight (rai::account const &);
 	std::unique_ptr<rai::block> successor (MDB_txn *, rai::block_hash const &);
 	std::unique_ptr<rai::block> forked_block (MDB_txn *, rai::block const &);
 	rai::block_hash latest (MDB_txn *, rai::account const &);
@@ -369,6 +510,8 @@ public:
 	std::string block_text (rai::block_hash const &);
 	rai::uint128_t supply (MDB_txn *);
 	rai::process_return process (MDB_txn *, rai::block const &);
+	// Process a block whose signature has already been checked against the given account
+	rai::process_return process (MDB_txn *, rai::block const &, rai::account const &);
 	void rollback (MDB_txn *, rai::block_hash const &);
 	void change_latest (MDB_txn *, rai::account const &, rai::block_hash const &, rai::account const &, rai::uint128_union const &, uint64_t);
 	void checksum_update (MDB_txn *, rai::block_hash const &);